@@ -0,0 +1,123 @@
+#include "console.h"
+
+Console::Console()
+    : _io(nullptr), _commands(nullptr), _count(0), _worker(nullptr), _fallback(nullptr),
+      _len(0), _overflow(false), _suspended(false)
+{
+}
+
+void Console::begin(Stream &io, const ConsoleCommand *commands, size_t count, ModemWorker &worker)
+{
+    _io = &io;
+    _commands = commands;
+    _count = count;
+    _worker = &worker;
+    _len = 0;
+    _overflow = false;
+}
+
+void Console::poll()
+{
+    if (!_io || _suspended)
+    {
+        return;
+    }
+
+    int avail = _io->available();
+    while (avail-- > 0)
+    {
+        int c = _io->read();
+        if (c < 0)
+        {
+            break;
+        }
+
+        if (c == '\r' || c == '\n')
+        {
+            if (!_overflow && _len > 0)
+            {
+                _line[_len] = '\0';
+                _dispatch();
+            }
+            _len = 0;
+            _overflow = false;
+        }
+        else if (c == '\b' || c == 0x7F)
+        {
+            if (_len > 0)
+            {
+                _len--;
+            }
+        }
+        else if (_len < LINE_SIZE - 1)
+        {
+            _line[_len++] = (char)c;
+        }
+        else
+        {
+            _overflow = true;
+        }
+    }
+}
+
+void Console::printHelp()
+{
+    _io->println("\n============================");
+    _io->println("可用命令:");
+    for (size_t i = 0; i < _count; i++)
+    {
+        _io->printf("%-10s - %s\n", _commands[i].name, _commands[i].help);
+    }
+    if (_fallback)
+    {
+        _io->println("其他输入作为AT指令发送");
+    }
+    _io->println("============================\n");
+}
+
+void Console::_dispatch()
+{
+    String line(_line);
+    line.trim();
+    if (line.length() == 0)
+    {
+        return;
+    }
+
+    int space = line.indexOf(' ');
+    String name = space < 0 ? line : line.substring(0, space);
+    String args = space < 0 ? String() : line.substring(space + 1);
+    args.trim();
+
+    const ConsoleCommand *command = nullptr;
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (name == _commands[i].name)
+        {
+            command = &_commands[i];
+            break;
+        }
+    }
+
+    if (!command)
+    {
+        if (_fallback && !_worker->submit("at", _fallback, line))
+        {
+            _io->println("命令队列已满, 请稍后重试");
+        }
+        return;
+    }
+
+    if (!command->async)
+    {
+        command->handler(args);
+    }
+    else if (_worker->submit(command->name, command->handler, args))
+    {
+        _io->println("已提交: " + name);
+    }
+    else
+    {
+        _io->println("命令队列已满, 请稍后重试");
+    }
+}
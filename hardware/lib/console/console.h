@@ -0,0 +1,71 @@
+/*
+ * 非阻塞串口命令行
+ * 逐字符读取输入, 收到完整一行后按命令表分发;
+ * 耗时命令交给调制解调器工作任务执行, 结果由工作任务异步输出
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "modemworker.h"
+
+// 命令表项
+struct ConsoleCommand
+{
+    const char *name;            // 命令名
+    const char *help;            // 帮助信息
+    ModemWorker::Job handler;    // 处理函数, 参数为命令名之后的内容
+    bool async;                  // 是否交给工作任务执行
+};
+
+class Console
+{
+public:
+    Console();
+
+    /**
+     * 初始化命令行
+     * @param io 输入输出串口
+     * @param commands 命令表
+     * @param count 命令数
+     * @param worker 执行耗时命令的工作任务
+     */
+    void begin(Stream &io, const ConsoleCommand *commands, size_t count, ModemWorker &worker);
+
+    /**
+     * 设置未匹配命令的处理函数(异步执行), 参数为整行输入
+     * @param handler 处理函数
+     */
+    void setFallback(ModemWorker::Job handler) { _fallback = handler; }
+
+    /**
+     * 读取已到达的输入并分发命令, 不会阻塞, 需在主循环中调用
+     */
+    void poll();
+
+    /**
+     * 暂停读取输入(如串口被透明桥接占用时)
+     * @param suspended 是否暂停
+     */
+    void setSuspended(bool suspended) { _suspended = suspended; }
+
+    /**
+     * 输出命令列表
+     */
+    void printHelp();
+
+private:
+    static const size_t LINE_SIZE = 192;
+
+    void _dispatch();
+
+    Stream *_io;
+    const ConsoleCommand *_commands;
+    size_t _count;
+    ModemWorker *_worker;
+    ModemWorker::Job _fallback;
+
+    char _line[LINE_SIZE];
+    size_t _len;
+    bool _overflow;   // 当前行超长, 丢弃到行尾
+    volatile bool _suspended;
+};
@@ -0,0 +1,210 @@
+#include "depthcodec.h"
+
+#define CODEC_MAGIC 'D'
+#define CODEC_VERSION 1
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+DepthEncoder::DepthEncoder()
+    : _buf(nullptr), _size(0), _len(0), _rle(true), _count(0), _run(0),
+      _prev{0, 0, 0}, _prevDelta(0)
+{
+}
+
+void DepthEncoder::begin(uint8_t *buffer, size_t size, bool rle)
+{
+    _buf = buffer;
+    _size = size;
+    _len = 0;
+    _rle = rle;
+    _count = 0;
+    _run = 0;
+    _prevDelta = 0;
+}
+
+void DepthEncoder::_putVarint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        _buf[_len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    _buf[_len++] = (uint8_t)value;
+}
+
+void DepthEncoder::_flushRun()
+{
+    if (_run > 0)
+    {
+        _putVarint((_run << 1) | 1);
+        _run = 0;
+    }
+}
+
+bool DepthEncoder::add(const DepthSample &sample)
+{
+    if (_count == 0)
+    {
+        // 块头和首个采样使用绝对值
+        if (!_buf || _size < 2 + MAX_ENTRY)
+        {
+            return false;
+        }
+        _buf[_len++] = CODEC_MAGIC;
+        _buf[_len++] = CODEC_VERSION;
+        _putVarint(sample.timestamp);
+        _putVarint(zigzag(sample.depth));
+        _putVarint(zigzag(sample.temperature));
+    }
+    else
+    {
+        int64_t delta = (int64_t)sample.timestamp - _prev.timestamp;
+        int64_t dod = delta - _prevDelta;
+        if (dod < -MAX_DOD || dod >= MAX_DOD || delta < INT32_MIN || delta > INT32_MAX)
+        {
+            return false;
+        }
+        int32_t depthDelta = sample.depth - _prev.depth;
+        int32_t tempDelta = sample.temperature - _prev.temperature;
+
+        if (_rle && dod == 0 && depthDelta == 0 && tempDelta == 0)
+        {
+            // 预留写出游程所需的空间
+            if (_len + 5 > _size)
+            {
+                return false;
+            }
+            _run++;
+        }
+        else
+        {
+            if (_len + (_run > 0 ? 5 : 0) + MAX_ENTRY > _size)
+            {
+                return false;
+            }
+            _flushRun();
+            _putVarint(zigzag((int32_t)dod) << 1);
+            _putVarint(zigzag(depthDelta));
+            _putVarint(zigzag(tempDelta));
+        }
+        _prevDelta = (int32_t)delta;
+    }
+
+    _prev = sample;
+    _count++;
+    return true;
+}
+
+size_t DepthEncoder::finish()
+{
+    _flushRun();
+    return _len;
+}
+
+DepthDecoder::DepthDecoder()
+    : _data(nullptr), _len(0), _pos(0), _first(false), _run(0),
+      _prev{0, 0, 0}, _prevDelta(0)
+{
+}
+
+bool DepthDecoder::_getVarint(uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && _pos < _len; shift += 7)
+    {
+        uint8_t b = _data[_pos++];
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DepthDecoder::begin(const uint8_t *data, size_t len)
+{
+    _data = data;
+    _len = len;
+    _pos = 0;
+    _run = 0;
+    _prevDelta = 0;
+    _first = false;
+
+    if (len < 2 || data[0] != CODEC_MAGIC || data[1] != CODEC_VERSION)
+    {
+        return false;
+    }
+    _pos = 2;
+
+    uint32_t ts, depth, temp;
+    if (!_getVarint(ts) || !_getVarint(depth) || !_getVarint(temp))
+    {
+        return false;
+    }
+    _prev.timestamp = ts;
+    _prev.depth = unzigzag(depth);
+    _prev.temperature = (int16_t)unzigzag(temp);
+    _first = true;
+    return true;
+}
+
+void DepthDecoder::_step(int32_t dod, int32_t depthDelta, int32_t tempDelta)
+{
+    _prevDelta += dod;
+    _prev.timestamp += (uint32_t)_prevDelta;
+    _prev.depth += depthDelta;
+    _prev.temperature = (int16_t)(_prev.temperature + tempDelta);
+}
+
+bool DepthDecoder::next(DepthSample &sample)
+{
+    if (_first)
+    {
+        _first = false;
+        sample = _prev;
+        return true;
+    }
+
+    if (_run == 0)
+    {
+        uint32_t header;
+        if (_pos >= _len || !_getVarint(header))
+        {
+            return false;
+        }
+
+        if (header & 1)
+        {
+            _run = header >> 1;
+            if (_run == 0)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            uint32_t depthDelta, tempDelta;
+            if (!_getVarint(depthDelta) || !_getVarint(tempDelta))
+            {
+                return false;
+            }
+            _step(unzigzag(header >> 1), unzigzag(depthDelta), unzigzag(tempDelta));
+            sample = _prev;
+            return true;
+        }
+    }
+
+    _run--;
+    _step(0, 0, 0);
+    sample = _prev;
+    return true;
+}
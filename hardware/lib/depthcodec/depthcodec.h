@@ -0,0 +1,105 @@
+/*
+ * 液位时间序列压缩编码
+ *
+ * 每个数据块独立解码, 格式:
+ *   'D' | 版本 | 首个采样(时间戳, 液位, 温度; varint)
+ *   之后每个条目以 varint 头开始:
+ *     头 = zigzag(时间戳二阶差分) << 1 | 0, 后跟 zigzag(液位差), zigzag(温度差)
+ *     头 = 连续相同采样个数 << 1 | 1 (游程: 间隔不变且数值不变)
+ *   二阶差分须在 [-2^30, 2^30) 内, 超出时(如RTC从0跳到网络时间)该采样开始新的数据块
+ *
+ * 不依赖 Arduino, 主机端可直接编译用于解码.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 单个采样
+struct DepthSample
+{
+    uint32_t timestamp;   // 时间戳(秒)
+    int32_t depth;        // 液位(0.1毫米)
+    int16_t temperature;  // 温度(0.1摄氏度)
+};
+
+class DepthEncoder
+{
+public:
+    DepthEncoder();
+
+    /**
+     * 开始一个新的数据块
+     * @param buffer 输出缓冲区
+     * @param size 缓冲区大小
+     * @param rle 是否对连续相同采样使用游程编码
+     */
+    void begin(uint8_t *buffer, size_t size, bool rle = true);
+
+    /**
+     * 追加一个采样
+     * @param sample 采样
+     * @return false: 缓冲区已满或时间戳跳变超出范围, 应先 finish() 发送本块再 begin() 新块
+     */
+    bool add(const DepthSample &sample);
+
+    /**
+     * 结束数据块
+     * @return 数据块长度
+     */
+    size_t finish();
+
+    size_t count() const { return _count; }   // 本块中的采样数
+    size_t length() const { return _len; }
+
+private:
+    static const size_t MAX_ENTRY = 16;  // 单个条目的最大长度
+    static const int64_t MAX_DOD = 1 << 30;  // 头中二阶差分的范围
+
+    void _putVarint(uint32_t value);
+    void _flushRun();
+
+    uint8_t *_buf;
+    size_t _size;
+    size_t _len;
+    bool _rle;
+
+    size_t _count;
+    uint32_t _run;        // 尚未写出的游程长度
+    DepthSample _prev;
+    int32_t _prevDelta;   // 上一个时间间隔
+};
+
+class DepthDecoder
+{
+public:
+    DepthDecoder();
+
+    /**
+     * 开始解码一个数据块
+     * @param data 数据块
+     * @param len 数据块长度
+     * @return 块头是否有效
+     */
+    bool begin(const uint8_t *data, size_t len);
+
+    /**
+     * 解码下一个采样
+     * @param sample 输出采样
+     * @return false: 数据结束或数据损坏
+     */
+    bool next(DepthSample &sample);
+
+private:
+    bool _getVarint(uint32_t &value);
+    void _step(int32_t dod, int32_t depthDelta, int32_t tempDelta);
+
+    const uint8_t *_data;
+    size_t _len;
+    size_t _pos;
+
+    bool _first;          // 首个采样尚未返回
+    uint32_t _run;        // 游程中剩余的采样数
+    DepthSample _prev;
+    int32_t _prevDelta;
+};
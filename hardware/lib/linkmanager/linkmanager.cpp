@@ -0,0 +1,173 @@
+#include "linkmanager.h"
+#include "logger.h"
+
+LinkManager::LinkManager(Modem &primary, Modem &secondary)
+    : _modems{&primary, &secondary}, _up{false, false}, _lastDial{0, 0}, _dialing{false, false},
+      _redials{{this, 0}, {this, 1}}, _active(-1), _next(0),
+      _apn("CMNET"), _username(""), _password(""), _redialInterval(60000), _aggregate(false),
+      _failovers(0), _lastFailoverLatency(0)
+{
+}
+
+void LinkManager::setAPN(const char *apn, const char *username, const char *password)
+{
+    _apn = apn;
+    _username = username;
+    _password = password;
+}
+
+bool LinkManager::begin()
+{
+    // 调制解调器可能是其他文件中的全局对象, 在这里而不是构造时访问
+    // 名称同时是NVS命名空间, 相同时两路会互相覆盖缓存的配置
+    if (strcmp(_modems[0]->name(), _modems[1]->name()) == 0)
+    {
+        LOG_W("两个调制解调器名称相同: " + String(_modems[0]->name()));
+    }
+
+    // 默认路由由链路管理统一切换
+    for (int i = 0; i < 2; i++)
+    {
+        _modems[i]->setDefaultRoute(false);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        _up[i] = _dial(i);
+        if (_up[i] && _active < 0)
+        {
+            _switchTo(i);
+        }
+    }
+    return _active >= 0;
+}
+
+bool LinkManager::_dial(int index)
+{
+    _lastDial[index] = millis();
+    LOG_I("链路" + String(index) + "开始拨号");
+    return _modems[index]->connect(_apn, _username, _password);
+}
+
+bool LinkManager::_switchTo(int index)
+{
+    if (!_modems[index]->setDefault())
+    {
+        return false;
+    }
+    _active = index;
+    LOG_I("默认路由切换到链路" + String(index));
+    return true;
+}
+
+void LinkManager::poll()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (!_dialing[i])
+        {
+            _modems[i]->poll();
+        }
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (_dialing[i])
+        {
+            continue;
+        }
+        bool up = _modems[i]->checkPPPStatus();
+        if (up == _up[i])
+        {
+            continue;
+        }
+        _up[i] = up;
+
+        if (!up)
+        {
+            LOG_W("链路" + String(i) + "断开");
+            if (i == _active)
+            {
+                // 立即切换到另一条在线链路, 耗时从协议栈报告断开算起
+                uint32_t lostAt = _modems[i]->linkLostAt();
+                int other = 1 - i;
+                _active = -1;
+                if (_up[other] && _switchTo(other))
+                {
+                    _failovers++;
+                    _lastFailoverLatency = micros() - lostAt;
+                    LOG_I("故障切换耗时 " + String(_lastFailoverLatency) + " us");
+                }
+            }
+        }
+        else if (_active < 0)
+        {
+            _switchTo(i);
+        }
+    }
+
+    // 断开的链路按间隔重拨, 拨通后由上面的状态检查接管; 主链路恢复后不抢回默认路由
+    for (int i = 0; i < 2; i++)
+    {
+        if (!_up[i] && !_dialing[i] && millis() - _lastDial[i] >= _redialInterval)
+        {
+            _redial(i);
+        }
+    }
+}
+
+void LinkManager::_redial(int index)
+{
+    _lastDial[index] = millis();
+    _dialing[index] = true;
+    char name[8];
+    snprintf(name, sizeof(name), "dial%d", index);
+    if (xTaskCreatePinnedToCore(_redialTask, name, 4096, &_redials[index], 1, nullptr,
+                                ARDUINO_RUNNING_CORE) != pdPASS)
+    {
+        LOG_E("链路" + String(index) + "重拨任务创建失败");
+        _dialing[index] = false;
+    }
+}
+
+void LinkManager::_redialTask(void *arg)
+{
+    Redial *redial = (Redial *)arg;
+    LinkManager *self = redial->manager;
+    int index = redial->index;
+
+    self->_modems[index]->hangup();
+    self->_dial(index);
+    self->_dialing[index] = false;
+    vTaskDelete(nullptr);
+}
+
+Modem *LinkManager::active()
+{
+    return _active >= 0 ? _modems[_active] : nullptr;
+}
+
+struct netif *LinkManager::nextNetif()
+{
+    if (_active < 0)
+    {
+        return nullptr;
+    }
+    if (!_aggregate)
+    {
+        return _modems[_active]->getNetif();
+    }
+
+    // 轮流使用在线链路
+    for (int n = 0; n < 2; n++)
+    {
+        int index = _next;
+        _next = 1 - _next;
+        struct netif *netif = _modems[index]->getNetif();
+        if (netif)
+        {
+            return netif;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,103 @@
+/*
+ * 双调制解调器链路管理
+ * 两路PPP链路同时在线, 主链路断开时立即把默认路由切换到备用链路;
+ * 可选把上传轮流分配到两条链路
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "modem.h"
+
+class LinkManager
+{
+public:
+    /**
+     * @param primary 主调制解调器
+     * @param secondary 备用调制解调器
+     */
+    LinkManager(Modem &primary, Modem &secondary);
+
+    /**
+     * 设置拨号参数
+     * @param apn APN名称
+     * @param username 用户名(可选)
+     * @param password 密码(可选)
+     */
+    void setAPN(const char *apn, const char *username = "", const char *password = "");
+
+    /**
+     * 设置断开链路的重拨间隔
+     * @param ms 重拨间隔(毫秒)
+     */
+    void setRedialInterval(uint32_t ms) { _redialInterval = ms; }
+
+    /**
+     * 是否把上传轮流分配到两条链路
+     * @param enable 是否启用
+     */
+    void setAggregate(bool enable) { _aggregate = enable; }
+
+    /**
+     * 接管两个调制解调器的默认路由设置, 依次拨号两条链路
+     * 调制解调器需已初始化串口
+     * @return 至少一条链路在线
+     */
+    bool begin();
+
+    /**
+     * 处理两条链路的PPP输入, 检测断开并切换, 需持续调用
+     * 断开的链路在单独的任务中重拨, 不影响在线链路的数据收发
+     */
+    void poll();
+
+    /**
+     * 当前承载默认路由的调制解调器, 两条链路都断开时返回 nullptr
+     */
+    Modem *active();
+
+    /**
+     * 为下一次上传选择网络接口, 上行连接绑定到该接口
+     * 未启用分流时总是返回默认路由的接口
+     * @return 没有在线链路时返回 nullptr
+     */
+    struct netif *nextNetif();
+
+    /**
+     * 链路是否正在后台重拨, 期间其他代码不能访问该调制解调器
+     * @param index 0: 主链路, 1: 备用链路
+     */
+    bool dialing(int index) const { return _dialing[index]; }
+
+    uint32_t failovers() const { return _failovers; }
+    uint32_t lastFailoverLatency() const { return _lastFailoverLatency; }  // 链路断开到默认路由切换完成的时间(微秒)
+
+private:
+    bool _dial(int index);
+    bool _switchTo(int index);
+    void _redial(int index);
+    static void _redialTask(void *arg);
+
+    // 重拨任务参数
+    struct Redial
+    {
+        LinkManager *manager;
+        int index;
+    };
+
+    Modem *_modems[2];
+    bool _up[2];               // 上次检查时链路是否在线
+    uint32_t _lastDial[2];     // 上次拨号的时间
+    volatile bool _dialing[2]; // 重拨任务运行中, 期间该调制解调器只由重拨任务访问
+    Redial _redials[2];
+    int _active;               // 承载默认路由的链路, -1表示都不在线
+    int _next;                 // 分流时下一次使用的链路
+
+    const char *_apn;
+    const char *_username;
+    const char *_password;
+    uint32_t _redialInterval;
+    bool _aggregate;
+
+    uint32_t _failovers;
+    uint32_t _lastFailoverLatency;
+};
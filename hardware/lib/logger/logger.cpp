@@ -38,6 +38,13 @@ void Logger::error(const String& message) {
     }
 }
 
+void Logger::log(LogLevel level, const char* module, const String& message) {
+    static const char* const names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    if (_level <= level && level != LogLevel::NONE) {
+        _print(names[(int)level], message, module);
+    }
+}
+
 void Logger::_formatTime(char* timeStr, size_t maxLen) {
     time_t now = (millis() / 1000) + _timeOffset;
     struct tm timeinfo;
@@ -45,14 +52,17 @@ void Logger::_formatTime(char* timeStr, size_t maxLen) {
     strftime(timeStr, maxLen, "%Y-%m-%d %H:%M:%S", &timeinfo);
 }
 
-void Logger::_print(const char* level, const String& message) {
+void Logger::_print(const char* level, const String& message, const char* module) {
     char timeStr[32];
     _formatTime(timeStr, sizeof(timeStr));
+    if (!module) {
+        module = _moduleName;
+    }
     
     _serial->print(timeStr);
     _serial->print(" - ");
-    if (_moduleName[0] != '\0') {
-        _serial->print(_moduleName);
+    if (module[0] != '\0') {
+        _serial->print(module);
         _serial->print(" - ");
     }
     _serial->print(level);
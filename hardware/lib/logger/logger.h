@@ -21,6 +21,7 @@ public:
 
     void begin(HardwareSerial& serial = Serial, LogLevel level = LogLevel::DEBUG);
     void setLogLevel(LogLevel level);
+    LogLevel getLogLevel() const { return _level; }
     void setModule(const char* moduleName);
     
     void debug(const String& message);
@@ -28,6 +29,24 @@ public:
     void warning(const String& message);
     void error(const String& message);
 
+    /**
+     * 按指定模块名输出, 不修改全局模块名
+     * 同一个类有多个实例(如两个调制解调器)时用于区分日志来源
+     * @param level 日志级别
+     * @param module 模块名
+     * @param message 日志内容
+     */
+    void log(LogLevel level, const char* module, const String& message);
+
+    template<typename... Args>
+    void logf(LogLevel level, const char* module, const char* format, Args... args) {
+        if (_level <= level) {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), format, args...);
+            log(level, module, buffer);
+        }
+    }
+
     template<typename... Args>
     void debugf(const char* format, Args... args) {
         if (_level <= LogLevel::DEBUG) {
@@ -55,7 +74,7 @@ private:
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
-    void _print(const char* level, const String& message);
+    void _print(const char* level, const String& message, const char* module = nullptr);
     void _formatTime(char* timeStr, size_t maxLen);
 
     HardwareSerial* _serial;
@@ -1,9 +1,29 @@
 #include "modem.h"
 #include "logger.h"
+#include <Preferences.h>
+
+// 日志模块名是全局的, 多个实例同时工作时每条日志带上本实例的名称
+#undef LOG_D
+#undef LOG_I
+#undef LOG_W
+#undef LOG_E
+#undef LOG_F
+#define LOG_D(msg) LOGGER.log(LogLevel::DEBUG, _name, msg)
+#define LOG_I(msg) LOGGER.log(LogLevel::INFO, _name, msg)
+#define LOG_W(msg) LOGGER.log(LogLevel::WARNING, _name, msg)
+#define LOG_E(msg) LOGGER.log(LogLevel::ERROR, _name, msg)
+#define LOG_F(...) LOGGER.logf(LogLevel::DEBUG, _name, __VA_ARGS__)
+
+// 缓存结构变化时递增
+#define PROFILE_VERSION 1
 
 Modem modem;
 
-Modem::Modem() : _uart(nullptr), _initialized(false), _ppp_pcb(nullptr), _ppp_connected(false)
+Modem::Modem(const char *name) : _name(name), _uart(nullptr), _initialized(false), _connectCount(0),
+                                 _ppp_pcb(nullptr), _ppp_connected(false), _linkLostAt(0), _pppPaused(false), _defaultRoute(true),
+                                 _pppProfile(PPPProfile::defaults()), _pppStats(), _capture(nullptr), _profile(),
+                                 _profileLoaded(false), _profileWarm(false), _imeiChecked(false), _tzReportSet(false), _bootToIpMs(0),
+                                 _socketAttached(false), _socketRecv(0), _socketClosed(0)
 {
 }
 
@@ -11,25 +31,61 @@ Modem::~Modem()
 {
 }
 
-bool Modem::begin(HardwareSerial &uart)
+bool Modem::begin(Stream &uart)
 {
     _uart = &uart;
     _initialized = false;
     _ppp_pcb = nullptr;
     _ppp_connected = false;
+    _pppPaused = false;
+    _tzReportSet = false;
+    _socketAttached = false;
 
     // 初始化TCP/IP协议栈
     esp_netif_init();
     
     _initialized = true;
-    LOG_MODULE("MODEM");
-    LOG_LEVEL(LogLevel::DEBUG);
+    _connectCount = 0;
     LOG_D("初始化调制解调器");
     return isReady();
 }
 
+void Modem::startTrace(uint8_t *buffer, size_t size)
+{
+    if (!_uart)
+    {
+        LOG_E("调制解调器未初始化");
+        return;
+    }
+
+    if (_uart != &_trace)
+    {
+        _trace.begin(*_uart, buffer, size);
+        _uart = &_trace;
+    }
+    _trace.start();
+    LOG_I("开始记录串口数据, 缓冲区: " + String(size) + " 字节");
+}
+
+void Modem::stopTrace()
+{
+    if (_uart != &_trace)
+    {
+        return;
+    }
+
+    _trace.stop();
+    _uart = _trace.source();
+    LOG_I("停止记录串口数据, 共 " + String(_trace.length()) + " 字节" +
+          (_trace.overflowed() ? " (缓冲区已满)" : ""));
+}
+
 bool Modem::isCommandMode()
 {
+    // 探测时向串口写入AT, 期间暂停PPP输出以免与PPP帧交错; 在命令模式时保持暂停
+    bool paused = _pppPaused;
+    _pppPaused = true;
+
     // 先尝试发送AT命令
     flushInput();
     _uart->println("AT");
@@ -53,6 +109,7 @@ bool Modem::isCommandMode()
     }
 
     LOG_D("当前在数据模式");
+    _pppPaused = paused;
     return false;
 }
 
@@ -65,6 +122,9 @@ bool Modem::setCommandMode()
 
     LOG_D("尝试进入命令模式...");
 
+    // 协议栈的输出会破坏+++前后的静默时间, 恢复数据模式前丢弃, 由TCP重传
+    _pppPaused = true;
+
     // 1. 输入+++前至少一秒内不可输入任何字符
     delay_ms(1100);
 
@@ -83,22 +143,39 @@ bool Modem::setCommandMode()
     flushInput();
 
     // 检查是否成功进入命令模式
-    return isCommandMode();
+    if (isCommandMode())
+    {
+        return true;
+    }
+    _pppPaused = false;
+    return false;
 }
 
 bool Modem::setDataMode()
 {
     if (!isCommandMode()) {  // 如果不是命令模式，就是数据模式
         LOG_D("已经在数据模式");
+        _pppPaused = false;
         return true;
     }
 
     String response = sendCommand("ATO");
     if (response.indexOf("CONNECT") >= 0) {
         LOG_D("数据模式恢复成功");
+        _pppPaused = false;
         return true;
     }
-    return connect("CMNET", "", "");
+
+    // 恢复失败时按上次的拨号参数重新拨号, 本次启动未拨号时使用缓存的APN
+    if (_dialApn.length() == 0) {
+        if (!profile().apn[0]) {
+            LOG_E("没有拨号参数, 无法恢复数据模式");
+            return false;
+        }
+        _dialApn = _profile.apn;
+    }
+    LOG_W("数据模式恢复失败, 重新拨号");
+    return connect(_dialApn.c_str(), _dialUsername.c_str(), _dialPassword.c_str());
 }
 
 String Modem::sendCommand(const String &command, uint32_t timeout)
@@ -150,6 +227,117 @@ String Modem::sendCommand(const String &command, uint32_t timeout)
     return response;
 }
 
+String Modem::sendCommandWithData(const String &command, const String &data, uint32_t timeout)
+{
+    return _sendWithPrompt(command, (const uint8_t *)data.c_str(), data.length(), true, timeout);
+}
+
+String Modem::_sendWithPrompt(const String &command, const uint8_t *data, size_t len, bool terminate,
+                              uint32_t timeout)
+{
+    if (!_initialized || !_uart)
+    {
+        LOG_E("调制解调器未初始化");
+        return "";
+    }
+
+    if (!isCommandMode() && !setCommandMode())
+    {
+        LOG_E("无法进入命令模式");
+        return "";
+    }
+
+    flushInput();
+    LOG_D("发送命令: " + command);
+    _uart->print(command);
+    _uart->print("\r");
+
+    // 等待输入提示符
+    String response;
+    unsigned long startTime = millis();
+    bool prompted = false;
+    while (!prompted && millis() - startTime < 5000)
+    {
+        if (_uart->available())
+        {
+            char c = _uart->read();
+            response += c;
+            prompted = c == '>';
+            if (response.endsWith("ERROR\r\n"))
+            {
+                break;
+            }
+        }
+        yield();
+    }
+
+    if (!prompted)
+    {
+        // 取消输入
+        _uart->write(0x1B);
+        LOG_E("未收到输入提示符");
+        return response;
+    }
+
+    // 指定了长度的指令按长度结束输入, 否则以Ctrl-Z结束
+    LOG_D("发送数据: " + String(len) + " 字节");
+    _uart->write(data, len);
+    if (terminate)
+    {
+        _uart->write(0x1A);
+    }
+
+    response = "";
+    startTime = millis();
+    while (millis() - startTime < timeout)
+    {
+        if (_uart->available())
+        {
+            char c = _uart->read();
+            response += c;
+            if (response.endsWith("\r\nOK\r\n") ||
+                response.endsWith("\r\nERROR\r\n") ||
+                response.endsWith("SEND OK\r\n") ||
+                response.endsWith("SEND FAIL\r\n") ||
+                (response.indexOf("+CMS ERROR") >= 0 && response.endsWith("\r\n")))
+            {
+                break;
+            }
+        }
+        yield();
+    }
+
+    LOG_D("完整响应: " + response);
+    return response;
+}
+
+bool Modem::_waitFor(const String &text, uint32_t timeout, String &line)
+{
+    // 等待包含 text 的一行(如URC)
+    line = "";
+    unsigned long startTime = millis();
+    while (millis() - startTime < timeout)
+    {
+        if (_uart->available())
+        {
+            char c = _uart->read();
+            line += c;
+            if (c == '\n')
+            {
+                line.trim();
+                if (line.indexOf(text) >= 0)
+                {
+                    return true;
+                }
+                _parseURC(line);
+                line = "";
+            }
+        }
+        yield();
+    }
+    return false;
+}
+
 bool Modem::isReady()
 {
     String response = sendCommand("AT");
@@ -168,6 +356,53 @@ void Modem::flushInput()
 }
 
 String Modem::getIMEI()
+{
+    // 信任缓存, 依赖缓存的指令失败时才由 revalidateProfile() 核对
+    if (profile().imei[0])
+    {
+        return _profile.imei;
+    }
+
+    String imei = _queryIMEI();
+    if (imei.length() > 0)
+    {
+        strncpy(_profile.imei, imei.c_str(), sizeof(_profile.imei) - 1);
+        _saveProfile();
+    }
+    return imei;
+}
+
+bool Modem::revalidateProfile()
+{
+    // 每次启动最多核对一次
+    if (_imeiChecked)
+    {
+        return false;
+    }
+    String imei = _queryIMEI();
+    if (imei.length() == 0)
+    {
+        return false;
+    }
+    _imeiChecked = true;
+    if (imei == profile().imei)
+    {
+        return false;
+    }
+
+    // 缓存属于另一个模块, 其中的模块信息、波特率、运营商等都不可用
+    bool stale = _profile.imei[0] != '\0';
+    if (stale)
+    {
+        LOG_W("IMEI与缓存不一致, 清除缓存: " + String(_profile.imei));
+        clearProfile();
+    }
+    strncpy(_profile.imei, imei.c_str(), sizeof(_profile.imei) - 1);
+    _saveProfile();
+    return stale;
+}
+
+String Modem::_queryIMEI()
 {
     String response = sendCommand("AT+GSN");
     if (response.indexOf("OK") < 0)
@@ -187,17 +422,171 @@ String Modem::getIMEI()
     return "";
 }
 
+String Modem::getModuleInfo()
+{
+    if (profile().info[0])
+    {
+        return _profile.info;
+    }
+
+    String response = sendCommand("ATI");
+    int end = response.lastIndexOf("\r\nOK\r\n");
+    if (end < 0)
+    {
+        return "";
+    }
+
+    // 去掉命令回显和结尾的OK
+    String info = response.substring(0, end);
+    int echo = info.indexOf("ATI");
+    if (echo >= 0)
+    {
+        info = info.substring(echo + 3);
+    }
+    info.trim();
+    info.replace("\r\n", " ");
+
+    strncpy(_profile.info, info.c_str(), sizeof(_profile.info) - 1);
+    _saveProfile();
+    return info;
+}
+
+const ModemProfile &Modem::profile()
+{
+    if (!_profileLoaded)
+    {
+        _profileLoaded = true;
+        Preferences prefs;
+        size_t len = 0;
+        if (prefs.begin(_name, true))
+        {
+            len = prefs.getBytes("profile", &_profile, sizeof(_profile));
+            prefs.end();
+        }
+        _profileWarm = len == sizeof(_profile) && _profile.version == PROFILE_VERSION;
+        if (!_profileWarm)
+        {
+            memset(&_profile, 0, sizeof(_profile));
+            _profile.version = PROFILE_VERSION;
+            _profile.rat = -1;
+        }
+    }
+    return _profile;
+}
+
+bool Modem::profileWarm()
+{
+    profile();
+    return _profileWarm;
+}
+
+void Modem::rememberBaudRate(uint32_t baud)
+{
+    if (profile().baud != baud)
+    {
+        _profile.baud = baud;
+        _saveProfile();
+    }
+}
+
+void Modem::clearProfile()
+{
+    Preferences prefs;
+    prefs.begin(_name, false);
+    prefs.remove("profile");
+    prefs.end();
+
+    memset(&_profile, 0, sizeof(_profile));
+    _profile.version = PROFILE_VERSION;
+    _profile.rat = -1;
+    _profileLoaded = true;
+    _profileWarm = false;
+    _tzReportSet = false;
+}
+
+void Modem::_saveProfile()
+{
+    Preferences prefs;
+    prefs.begin(_name, false);
+    prefs.putBytes("profile", &_profile, sizeof(_profile));
+    prefs.end();
+}
+
+void Modem::_rememberOperator()
+{
+    // 先读取缓存, 否则保存时会用空配置覆盖NVS中的缓存
+    profile();
+    String response = sendCommand("AT+COPS?");
+    int index = response.indexOf("+COPS:");
+    if (index < 0)
+    {
+        return;
+    }
+
+    // 格式: +COPS: <mode>,<format>,"<oper>"[,<AcT>]
+    unsigned mode, format;
+    char oper[sizeof(_profile.oper)];
+    int rat = -1;
+    if (sscanf(response.c_str() + index, "+COPS: %u,%u,\"%31[^\"]\",%d", &mode, &format, oper, &rat) < 3)
+    {
+        return;
+    }
+
+    if (strcmp(oper, _profile.oper) != 0 || format != _profile.operFormat || rat != _profile.rat)
+    {
+        strcpy(_profile.oper, oper);
+        _profile.operFormat = format;
+        _profile.rat = rat;
+        _saveProfile();
+        LOG_D("记录运营商: " + String(oper) + ", 接入技术 " + String(rat));
+    }
+}
+
+bool Modem::_selectCachedOperator()
+{
+    if (!profile().oper[0])
+    {
+        return false;
+    }
+
+    // 手动选网失败时模块自动回退到自动选网(模式4)
+    LOG_D("按缓存选择运营商: " + String(_profile.oper));
+    String cmd = "AT+COPS=4," + String(_profile.operFormat) + ",\"" + _profile.oper + "\"";
+    if (_profile.rat >= 0)
+    {
+        cmd += "," + String(_profile.rat);
+    }
+    bool ok = sendCommand(cmd, 30000).indexOf("OK") >= 0;
+
+    // 注册成功后重新记录实际注册的运营商
+    _profile.oper[0] = '\0';
+    if (!ok)
+    {
+        // 可能更换了模块或SIM卡, 核对缓存是否属于当前模块
+        LOG_W("缓存的运营商不可用");
+        if (!revalidateProfile())
+        {
+            _saveProfile();
+        }
+    }
+    return ok;
+}
+
 time_t Modem::getNetworkTime() {
     // 确保在命令模式
     if (!isCommandMode() && !setCommandMode()) {
         return 0;
     }
 
-    // 设置时区为中国(GMT+8)
-    String response = sendCommand("AT+CTZR=1");
-    if (response.indexOf("OK") < 0) {
-        LOG_E("设置时区报告失败");
-        return 0;
+    // 设置时区为中国(GMT+8), 模块复位前只需设置一次
+    String response;
+    if (!_tzReportSet) {
+        response = sendCommand("AT+CTZR=1");
+        if (response.indexOf("OK") < 0) {
+            LOG_E("设置时区报告失败");
+            return 0;
+        }
+        _tzReportSet = true;
     }
 
     // 查询网络时间
@@ -272,13 +661,19 @@ time_t Modem::getNetworkTime() {
 
 bool Modem::connect(const char *apn, const char *username, const char *password)
 {
-    static int connectCount = 0; // 连接尝试计数
+    // 记录拨号参数, 用于恢复数据模式失败时重新拨号
+    if (apn != _dialApn.c_str())
+    {
+        _dialApn = apn;
+        _dialUsername = username;
+        _dialPassword = password;
+    }
 
     // 如果尝试次数超过5次，返回失败
-    if (connectCount >= 5)
+    if (_connectCount >= 5)
     {
         LOG_E("连接尝试次数超过5次，放弃连接");
-        connectCount = 0;
+        _connectCount = 0;
         return false;
     }
 
@@ -295,7 +690,7 @@ bool Modem::connect(const char *apn, const char *username, const char *password)
     {
         LOG_E("SIM卡未就绪");
         delay_ms(1000); // 等待1秒后重试
-        connectCount++;
+        _connectCount++;
         return connect(apn, username, password);
     }
 
@@ -304,17 +699,24 @@ bool Modem::connect(const char *apn, const char *username, const char *password)
     response = sendCommand("AT+CREG?");
     if (response.indexOf("+CREG: 0,1") < 0 && response.indexOf("+CREG: 0,5") < 0)
     {
-        // 如果未注册，等待3秒后重试
-        LOG_W("等待3秒进行网络注册");
-        delay_ms(3000);
+        // 有缓存的运营商时直接选网, 否则等待3秒后重试
+        if (!_selectCachedOperator())
+        {
+            LOG_W("等待3秒进行网络注册");
+            delay_ms(3000);
+        }
         response = sendCommand("AT+CREG?");
         if (response.indexOf("+CREG: 0,1") < 0 && response.indexOf("+CREG: 0,5") < 0)
         {
             LOG_E("网络注册失败");
-            connectCount++;
+            _connectCount++;
             return connect(apn, username, password);
         }
     }
+    if (!profile().oper[0])
+    {
+        _rememberOperator();
+    }
 
     // 网络注册成功后更新时间
     LOG_D("尝试更新网络时间");
@@ -335,23 +737,34 @@ bool Modem::connect(const char *apn, const char *username, const char *password)
         if (response.indexOf("OK") < 0)
         {
             LOG_E("PS网络附着失败");
-            connectCount++;
+            _connectCount++;
             return connect(apn, username, password);
         }
         delay_ms(1000); // 等待1秒让PS附着完成
     }
 
-    // 4. 设置PDP上下文 (AT+CGDCONT)
-    LOG_D("设置APN");
-    String cmd = "AT+CGDCONT=1,\"IP\",\"";
-    cmd += apn;
-    cmd += "\"";
-    response = sendCommand(cmd);
-    if (response.indexOf("OK") < 0)
+    // 4. 设置PDP上下文 (AT+CGDCONT), 模块会保存该设置, 与缓存一致时跳过
+    String cmd;
+    if (strcmp(profile().apn, apn) == 0)
     {
-        LOG_E("APN设置失败");
-        connectCount++;
-        return connect(apn, username, password);
+        LOG_D("APN已设置: " + String(apn));
+    }
+    else
+    {
+        LOG_D("设置APN");
+        cmd = "AT+CGDCONT=1,\"IP\",\"";
+        cmd += apn;
+        cmd += "\"";
+        response = sendCommand(cmd);
+        if (response.indexOf("OK") < 0)
+        {
+            LOG_E("APN设置失败");
+            _connectCount++;
+            return connect(apn, username, password);
+        }
+        strncpy(_profile.apn, apn, sizeof(_profile.apn) - 1);
+        _profile.apn[sizeof(_profile.apn) - 1] = '\0';
+        _saveProfile();
     }
 
     // 5. 如果有用户名密码，设置认证 (AT+CGAUTH)
@@ -366,26 +779,38 @@ bool Modem::connect(const char *apn, const char *username, const char *password)
         if (response.indexOf("OK") < 0)
         {
             LOG_E("认证信息设置失败");
-            connectCount++;
+            _connectCount++;
             return connect(apn, username, password);
         }
     }
 
-    // 6. 激活PDP上下文并进行PPP拨号
+    // 6. 激活PDP上下文并进行PPP拨号, 内置协议栈占用的上下文需先释放
+    if (_socketAttached)
+    {
+        sendCommand("AT+QIDEACT=1", 40000);
+        _socketAttached = false;
+    }
     LOG_D("开始PPP拨号");
     response = sendCommand("ATD*99#", 15000);
     if (response.indexOf("CONNECT") < 0)
     {
         LOG_E("PPP拨号失败");
-        connectCount++;
+        // PDP上下文可能已被修改或更换了模块, 核对缓存并在重试时重新设置
+        if (!revalidateProfile() && _profile.apn[0])
+        {
+            _profile.apn[0] = '\0';
+            _saveProfile();
+        }
+        _connectCount++;
         return connect(apn, username, password);
     }
 
     // 在收到CONNECT响应后，初始化PPP
     if (response.indexOf("CONNECT") >= 0) {
         LOG_I("调制解调器已切换到数据模式");
+        _pppPaused = false;
         
-        if (!_initPPP()) {
+        if (!_initPPP(username, password)) {
             LOG_E("PPP初始化失败");
             return false;
         }
@@ -399,17 +824,17 @@ bool Modem::connect(const char *apn, const char *username, const char *password)
             delay(100);
             
             // 处理PPP输入数据
-            uint8_t buffer[256];
-            while (_uart->available()) {
-                int len = _uart->read(buffer, sizeof(buffer));
-                if (len > 0) {
-                    pppos_input_tcpip(_ppp_pcb, buffer, len);
-                }
-            }
+            _pppInput();
         }
 
         if (_ppp_connected) {
             LOG_I("PPP连接成功建立");
+            _connectCount = 0;
+            if (_bootToIpMs == 0) {
+                _bootToIpMs = millis();
+                LOG_I("启动到获取IP: " + String(_bootToIpMs) + " ms, 配置缓存: " +
+                      (_profileWarm ? "有效" : "无效"));
+            }
             return true;
         } else {
             LOG_E("PPP连接超时");
@@ -421,6 +846,225 @@ bool Modem::connect(const char *apn, const char *username, const char *password)
     return false;
 }
 
+bool Modem::socketAttach(const char *apn)
+{
+    if (_socketAttached)
+    {
+        return true;
+    }
+    if (checkPPPStatus())
+    {
+        LOG_E("PPP连接期间不能使用内置协议栈");
+        return false;
+    }
+
+    String response = sendCommand("AT+QIACT?");
+    if (response.indexOf("+QIACT: 1,1") < 0)
+    {
+        String cmd = "AT+QICSGP=1,1,\"";
+        cmd += apn;
+        cmd += "\",\"\",\"\",1";
+        if (sendCommand(cmd).indexOf("OK") < 0)
+        {
+            LOG_E("设置内置协议栈APN失败");
+            return false;
+        }
+        // 最长响应时间150秒
+        if (sendCommand("AT+QIACT=1", 150000).indexOf("OK") < 0)
+        {
+            LOG_E("激活PDP上下文失败");
+            return false;
+        }
+    }
+
+    _socketAttached = true;
+    return true;
+}
+
+bool Modem::socketOpen(uint8_t id, ModemSocketType type, const char *host, uint16_t port, uint32_t timeout)
+{
+    if (!_socketAttached)
+    {
+        LOG_E("PDP上下文未激活");
+        return false;
+    }
+
+    String cmd = "AT+QIOPEN=1," + String(id) + ",\"" + (type == MODEM_SOCKET_TCP ? "TCP" : "UDP") +
+                 "\",\"" + host + "\"," + String(port) + ",0,0";
+    if (sendCommand(cmd, 5000).indexOf("OK") < 0)
+    {
+        return false;
+    }
+
+    // 连接结果通过 +QIOPEN: <id>,<err> 上报
+    String urc = "+QIOPEN: " + String(id) + ",";
+    String line;
+    if (!_waitFor(urc, timeout, line))
+    {
+        LOG_E("等待连接结果超时");
+        socketClose(id);
+        return false;
+    }
+    int err = line.substring(line.indexOf(urc) + urc.length()).toInt();
+    if (err != 0)
+    {
+        LOG_E("建立连接失败, 错误码: " + String(err));
+        socketClose(id);
+        return false;
+    }
+    _socketRecv &= ~(1 << id);
+    _socketClosed &= ~(1 << id);
+    return true;
+}
+
+bool Modem::socketSend(uint8_t id, const uint8_t *data, size_t len)
+{
+    // 单次最多发送1460字节
+    size_t sent = 0;
+    while (sent < len)
+    {
+        size_t n = min(len - sent, (size_t)1460);
+        String response = _sendWithPrompt("AT+QISEND=" + String(id) + "," + String(n), data + sent, n,
+                                          false, 10000);
+        if (response.indexOf("SEND OK") < 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+int Modem::socketRead(uint8_t id, uint8_t *buffer, size_t max)
+{
+    if (!_initialized || !_uart || checkPPPStatus())
+    {
+        return -1;
+    }
+
+    // 响应格式: +QIRD: <长度>\r\n<数据>\r\n\r\nOK\r\n, 数据按长度读取
+    // 之前收到的上报不能丢弃, 逐行处理
+    _readURC();
+    _uart->print("AT+QIRD=" + String(id) + "," + String(max) + "\r");
+
+    String line;
+    int len = -1;
+    unsigned long startTime = millis();
+    while (len < 0 && millis() - startTime < 1000)
+    {
+        if (!_uart->available())
+        {
+            yield();
+            continue;
+        }
+        char c = _uart->read();
+        if (c != '\n')
+        {
+            line += c;
+            continue;
+        }
+        line.trim();
+        if (line.startsWith("+QIRD: "))
+        {
+            len = line.substring(7).toInt();
+        }
+        else if (line == "ERROR")
+        {
+            return -1;
+        }
+        else
+        {
+            _parseURC(line);
+        }
+        line = "";
+    }
+    if (len < 0)
+    {
+        return -1;
+    }
+
+    size_t n = 0;
+    while (n < (size_t)len && millis() - startTime < 1000)
+    {
+        if (_uart->available())
+        {
+            buffer[n++] = _uart->read();
+        }
+        else
+        {
+            yield();
+        }
+    }
+
+    String tail;
+    _waitFor("OK", 1000, tail);
+
+    // 读空后等待下一次 "recv" 上报; 对端已关闭且没有剩余数据时结束
+    if (len == 0)
+    {
+        _socketRecv &= ~(1 << id);
+        if (_socketClosed & (1 << id))
+        {
+            LOG_D("连接 " + String(id) + " 已被对端关闭");
+            return -1;
+        }
+    }
+    return n;
+}
+
+void Modem::socketClose(uint8_t id)
+{
+    sendCommand("AT+QICLOSE=" + String(id), 10000);
+    _socketRecv &= ~(1 << id);
+    _socketClosed &= ~(1 << id);
+}
+
+void Modem::_readURC()
+{
+    String line;
+    while (_uart->available())
+    {
+        char c = _uart->read();
+        if (c == '\n')
+        {
+            line.trim();
+            _parseURC(line);
+            line = "";
+        }
+        else
+        {
+            line += c;
+        }
+    }
+}
+
+void Modem::_parseURC(const String &line)
+{
+    // 格式: +QIURC: "recv",<连接号> / +QIURC: "closed",<连接号>
+    if (!line.startsWith("+QIURC: "))
+    {
+        return;
+    }
+    int comma = line.indexOf(',');
+    if (comma < 0)
+    {
+        return;
+    }
+    int id = line.substring(comma + 1).toInt();
+    if (id < 0 || id >= 16)
+    {
+        return;
+    }
+    if (line.indexOf("\"closed\"") > 0)
+    {
+        _socketClosed |= 1 << id;
+    }
+    else if (line.indexOf("\"recv\"") > 0)
+    {
+        _socketRecv |= 1 << id;
+    }
+}
+
 bool Modem::hangup()
 {
     // 先清理PPP连接
@@ -436,6 +1080,32 @@ bool Modem::hangup()
     return (response.indexOf("OK") >= 0 || response.indexOf("NO CARRIER") >= 0);
 }
 
+bool Modem::setDefault()
+{
+    if (!_ppp_pcb) {
+        return false;
+    }
+    return pppapi_set_default(_ppp_pcb) == ERR_OK;
+}
+
+struct netif *Modem::getNetif()
+{
+    return checkPPPStatus() ? &_ppp_netif : nullptr;
+}
+
+void Modem::poll()
+{
+    if (_ppp_pcb)
+    {
+        _pppInput();
+    }
+}
+
+bool Modem::checkPPPStatus()
+{
+    return _ppp_pcb != nullptr && _ppp_connected;
+}
+
 void Modem::delay_ms(uint32_t ms)
 {
     unsigned long start = millis();
@@ -449,33 +1119,124 @@ void Modem::delay_ms(uint32_t ms)
 u32_t Modem::_pppOutputCallback(ppp_pcb *pcb, u8_t *data, u32_t len, void *ctx)
 {
     Modem* modem = (Modem*)ctx;
-    if (modem && modem->_uart) {
-        return modem->_uart->write(data, len);
+    if (modem && modem->_uart && !modem->_pppPaused) {
+        for (u32_t i = 0; i < len; i++) {
+            if (data[i] == 0x7E) {
+                modem->_pppStats.txFlags++;
+            } else if (data[i] == 0x7D) {
+                modem->_pppStats.txEscaped++;
+            }
+        }
+        u32_t written = modem->_uart->write(data, len);
+        modem->_pppStats.txBytes += written;
+        return written;
     }
     return 0;
 }
 
+// PPP输入: 串口数据交给协议栈
+void Modem::_pppInput()
+{
+    uint8_t buffer[256];
+    while (_uart->available()) {
+        int len = _uart->readBytes(buffer, min((size_t)_uart->available(), sizeof(buffer)));
+        if (len <= 0) {
+            break;
+        }
+        for (int i = 0; i < len; i++) {
+            if (buffer[i] == 0x7E) {
+                _pppStats.rxFlags++;
+            } else if (buffer[i] == 0x7D) {
+                _pppStats.rxEscaped++;
+            }
+        }
+        _pppStats.rxBytes += len;
+        if (_capture) {
+            _capture->input(buffer, len);
+        }
+        pppos_input_tcpip(_ppp_pcb, buffer, len);
+    }
+}
+
+// PPP阶段回调函数
+void Modem::_pppPhaseCallback(ppp_pcb *pcb, u8_t phase, void *ctx)
+{
+    Modem* modem = (Modem*)ctx;
+    // 拨号时协议栈会重置LCP/IPCP选项, 需在LCP协商开始前重新应用配置
+    if (modem && phase == PPP_PHASE_ESTABLISH) {
+        modem->_applyPPPProfile();
+    }
+}
+
+void Modem::_applyPPPProfile()
+{
+    lcp_options *wo = &_ppp_pcb->lcp_wantoptions;
+    lcp_options *ao = &_ppp_pcb->lcp_allowoptions;
+
+    wo->neg_asyncmap = 1;
+    wo->asyncmap = _pppProfile.accm;
+    wo->neg_mru = 1;
+    wo->mru = _pppProfile.mru;
+    ao->mru = _pppProfile.mtu;
+
+#if VJ_SUPPORT
+    _ppp_pcb->ipcp_wantoptions.neg_vj = _pppProfile.vjCompression;
+    _ppp_pcb->ipcp_allowoptions.neg_vj = _pppProfile.vjCompression;
+#endif
+}
+
 // PPP链路状态回调函数
 void Modem::_pppLinkStatusCallback(ppp_pcb *pcb, int err_code, void *ctx)
 {
     Modem* modem = (Modem*)ctx;
-    if (!modem) return;
+    if (modem) {
+        modem->_onLinkStatus(pcb, err_code);
+    }
+}
 
+void Modem::_onLinkStatus(ppp_pcb *pcb, int err_code)
+{
     if (err_code == PPPERR_NONE) {
-        modem->_ppp_connected = true;
+        _ppp_connected = true;
         struct netif *pppif = ppp_netif(pcb);
         
         LOG_I("PPP连接已建立");
         LOG_I("IP地址: " + String(ip4addr_ntoa(netif_ip4_addr(pppif))));
         LOG_I("网关: " + String(ip4addr_ntoa(netif_ip4_gw(pppif))));
         LOG_I("子网掩码: " + String(ip4addr_ntoa(netif_ip4_netmask(pppif))));
+
+        // 记录协商结果
+        PPPLinkStats &stats = _pppStats;
+        const lcp_options *go = &pcb->lcp_gotoptions;
+        const lcp_options *ho = &pcb->lcp_hisoptions;
+        stats.rxMru = go->neg_mru ? go->mru : PPP_DEFMRU;
+        stats.txMru = ho->neg_mru ? ho->mru : PPP_DEFMRU;
+        stats.rxAccm = go->neg_asyncmap ? go->asyncmap : 0xFFFFFFFF;
+        stats.txAccm = ho->neg_asyncmap ? ho->asyncmap : 0xFFFFFFFF;
+        stats.acfc = ho->neg_accompression;
+#if VJ_SUPPORT
+        stats.rxVj = pcb->ipcp_gotoptions.neg_vj;
+        stats.txVj = pcb->ipcp_hisoptions.neg_vj;
+#else
+        stats.rxVj = false;
+        stats.txVj = false;
+#endif
+        if (_pppProfile.debug) {
+            LOG_I("MRU: 本端 " + String(stats.rxMru) + ", 对端 " + String(stats.txMru));
+            LOG_F("ACCM: 接收 0x%08lX, 发送 0x%08lX", (unsigned long)stats.rxAccm, (unsigned long)stats.txAccm);
+            LOG_I("VJ压缩: 接收 " + String(stats.rxVj ? "开" : "关") + ", 发送 " + String(stats.txVj ? "开" : "关"));
+            LOG_I("协商开销: " + String(stats.overheadRatio() * 100, 1) + "%");
+        }
     } else {
-        modem->_ppp_connected = false;
+        if (_ppp_connected) {
+            _linkLostAt = micros();
+        }
+        _ppp_connected = false;
         LOG_E("PPP连接断开，错误码: " + String(err_code));
     }
 }
 
-bool Modem::_initPPP()
+bool Modem::_initPPP(const char *username, const char *password)
 {
     if (_ppp_pcb) {
         LOG_W("PPP已经初始化");
@@ -492,9 +1253,32 @@ bool Modem::_initPPP()
         LOG_E("PPP接口创建失败");
         return false;
     }
+    if (_capture) {
+        _capture->attach(&_ppp_netif);
+    }
+
+    // 认证方式在拨号时不会被重置, 链路选项在阶段回调中应用
+#if PPP_AUTH_SUPPORT
+    if (_pppProfile.authType == PPPAUTHTYPE_NONE && username && username[0]) {
+        LOG_W("链路配置不认证, 忽略用户名和密码");
+    }
+    ppp_set_auth(_ppp_pcb, _pppProfile.authType, username, password);
+#endif
+#if LWIP_DNS
+    // 使用对端下发的DNS服务器
+    ppp_set_usepeerdns(_ppp_pcb, 1);
+#endif
+#if PPP_NOTIFY_PHASE
+    ppp_set_notify_phase_callback(_ppp_pcb, _pppPhaseCallback);
+#else
+    LOG_W("协议栈未启用PPP_NOTIFY_PHASE, 链路配置不生效");
+#endif
+    _pppStats = PPPLinkStats();
 
     // 设置为默认接口
-    pppapi_set_default(_ppp_pcb);
+    if (_defaultRoute) {
+        pppapi_set_default(_ppp_pcb);
+    }
 
     LOG_D("PPP接口创建成功");
     return true;
@@ -503,9 +1287,34 @@ bool Modem::_initPPP()
 void Modem::_cleanupPPP()
 {
     if (_ppp_pcb) {
+        // 发送LCP终止请求并等待对端确认, 超时则不等确认直接结束
         pppapi_close(_ppp_pcb, 0);
+        unsigned long start = millis();
+        while (_ppp_pcb->phase != PPP_PHASE_DEAD && millis() - start < 3000) {
+            _pppInput();
+            delay(10);
+        }
+        if (_ppp_pcb->phase != PPP_PHASE_DEAD) {
+            pppapi_close(_ppp_pcb, 1);
+        }
+        // 释放控制块并移除网络接口, 下次拨号重新创建
+        pppapi_free(_ppp_pcb);
         _ppp_pcb = nullptr;
     }
+    if (_capture) {
+        _capture->detach();
+    }
     _ppp_connected = false;
 }
 
+void Modem::setCapture(PppCapture *capture)
+{
+    if (_capture) {
+        _capture->detach();
+    }
+    _capture = capture;
+    if (_capture && _ppp_pcb) {
+        _capture->attach(&_ppp_netif);
+    }
+}
+
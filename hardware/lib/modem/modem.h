@@ -6,6 +6,8 @@
 #include <Arduino.h>
 #include <NetworkInterface.h>
 #include "logger.h" // 添加logger头文件
+#include "uarttrace.h"
+#include "pppcapture.h"
 #include <lwip/opt.h>
 #include <lwip/sys.h>
 #include <lwip/netif.h>
@@ -13,18 +15,124 @@
 #include <netif/ppp/pppos.h>
 #include <esp_netif.h>
 
+// PPP链路配置
+struct PPPProfile
+{
+    uint32_t accm;         // 要求对端使用的异步控制字符映射, 0表示接收方向不转义控制字符
+    bool vjCompression;    // Van Jacobson TCP/IP头压缩
+    uint16_t mru;          // 最大接收单元
+    uint16_t mtu;          // 最大发送单元(不超过对端MRU)
+    uint8_t authType;      // 认证方式 PPPAUTHTYPE_*, NONE 时拒绝对端要求的认证
+    bool debug;            // 输出链路协商结果和统计
+
+    /**
+     * lwIP默认配置, 接受对端要求的任意认证方式
+     */
+    static PPPProfile defaults()
+    {
+        return {0x00000000, true, 1500, 1500, PPPAUTHTYPE_ANY, true};
+    }
+
+    /**
+     * 兼容配置: 转义全部控制字符且不压缩头部, 用于不规范的对端
+     */
+    static PPPProfile compatible()
+    {
+        return {0xFFFFFFFF, false, 1500, 1500, PPPAUTHTYPE_ANY, true};
+    }
+};
+
+// PPP链路协商结果和线路统计
+struct PPPLinkStats
+{
+    // 协商结果
+    uint16_t rxMru;        // 本端MRU
+    uint16_t txMru;        // 对端MRU
+    uint32_t rxAccm;       // 对端发送时使用的ACCM
+    uint32_t txAccm;       // 本端发送时使用的ACCM
+    bool rxVj;             // 对端向本端发送压缩头
+    bool txVj;             // 本端向对端发送压缩头
+    bool acfc;             // 地址/控制字段压缩
+
+    // 线路统计(HDLC编码后的字节)
+    uint32_t txBytes;
+    uint32_t txFlags;      // 帧标志字节0x7E
+    uint32_t txEscaped;    // 转义字节0x7D
+    uint32_t rxBytes;
+    uint32_t rxFlags;
+    uint32_t rxEscaped;
+
+    /**
+     * 估算线路开销比例: (转义 + 帧标志 + FCS + 地址/控制字段) / 线路字节数
+     * 按每个帧标志对应一帧估算
+     */
+    float overheadRatio() const
+    {
+        uint32_t bytes = txBytes + rxBytes;
+        if (bytes == 0)
+        {
+            return 0;
+        }
+        uint32_t frames = txFlags + rxFlags;
+        uint32_t overhead = txEscaped + rxEscaped + frames * (acfc ? 3 : 5);
+        return (float)overhead / bytes;
+    }
+};
+
+// 缓存在NVS中的模块信息和上次可用的配置, 启动时用于跳过查询
+struct ModemProfile
+{
+    uint8_t version;       // 结构版本, 不一致时丢弃缓存
+    uint32_t baud;         // 上次可用的波特率, 0表示未知
+    char imei[16];         // IMEI号
+    char info[64];         // ATI返回的模块信息
+    char apn[32];          // 已写入PDP上下文1的APN
+    char oper[32];         // 上次注册的运营商
+    uint8_t operFormat;    // 运营商名称格式(AT+COPS第二个参数)
+    int8_t rat;            // 接入技术, -1表示未知
+};
+
+// 模块内置协议栈的socket类型
+enum ModemSocketType
+{
+    MODEM_SOCKET_TCP,
+    MODEM_SOCKET_UDP
+};
+
 class Modem
 {
 public:
-    Modem();
+    /**
+     * @param name 日志模块名和NVS命名空间(最长15字符), 多个调制解调器时必须各不相同
+     */
+    explicit Modem(const char *name = "MODEM");
     ~Modem();
 
+    const char *name() const { return _name; }
+
     /**
      * 初始化调制解调器
-     * @param uart 串口对象
+     * @param uart 串口对象(也可以是回放用的 UartReplay)
      * @return 是否初始化成功
      */
-    bool begin(HardwareSerial &uart);
+    bool begin(Stream &uart);
+
+    /**
+     * 开始记录串口收发数据
+     * @param buffer 记录缓冲区
+     * @param size 缓冲区大小
+     */
+    void startTrace(uint8_t *buffer, size_t size);
+
+    /**
+     * 停止记录, 已记录的数据仍可通过 trace() 读取
+     */
+    void stopTrace();
+
+    /**
+     * 获取串口记录器
+     */
+    UartTrace &trace() { return _trace; }
 
     /**
      * 检查调制解调器是否就绪
@@ -33,11 +141,51 @@ public:
     bool isReady();
 
     /**
-     * 获取模块IMEI号
+     * 获取模块IMEI号, 优先使用缓存, 没有缓存时查询(AT+GSN)
      * @return IMEI号字符串，获取失败返回空字符串
      */
     String getIMEI();
 
+    /**
+     * 获取模块信息(ATI), 优先使用缓存
+     * @return 模块信息，获取失败返回空字符串
+     */
+    String getModuleInfo();
+
+    /**
+     * 获取缓存的模块配置, 首次调用时从NVS读取
+     */
+    const ModemProfile &profile();
+
+    /**
+     * 缓存是否在本次启动前已经存在
+     */
+    bool profileWarm();
+
+    /**
+     * 记录当前可用的波特率, 下次启动直接使用
+     * @param baud 波特率
+     */
+    void rememberBaudRate(uint32_t baud);
+
+    /**
+     * 清除缓存的模块配置, 下次启动重新查询
+     */
+    void clearProfile();
+
+    /**
+     * 核对缓存是否属于当前模块, 在依赖缓存的指令失败或注册结果与缓存不符时调用
+     * 查询IMEI(每次启动最多一次)并与缓存比较, 不一致(更换了模块)时清除缓存
+     * @return 是否清除了缓存
+     */
+    bool revalidateProfile();
+
+    /**
+     * 本次启动到PPP获取IP地址的时间
+     * @return 毫秒, 尚未连接时返回0
+     */
+    uint32_t bootToIpMs() const { return _bootToIpMs; }
+
     /**
      * 从网络获取时间并更新RTC
      * @return 获取到的时间戳，失败返回0
@@ -57,7 +205,7 @@ public:
     bool setCommandMode();
 
     /**
-     * 切换到数据模式
+     * 切换到数据模式, ATO恢复失败时按上次的拨号参数重新拨号
      * @return 是否切换成功
      */
     bool setDataMode();
@@ -70,6 +218,15 @@ public:
      */
     String sendCommand(const String &command, uint32_t timeout = 1000);
 
+    /**
+     * 发送需要输入数据的AT指令(如AT+CMGS), 收到">"提示符后发送数据并以Ctrl-Z结束
+     * @param command AT指令
+     * @param data 提示符后发送的数据
+     * @param timeout 发送数据后等待最终响应的超时时间(ms)
+     * @return 调制解调器返回的响应字符串
+     */
+    String sendCommandWithData(const String &command, const String &data, uint32_t timeout = 60000);
+
     /**
      * 进行PPP拨号
      * @param apn APN名称
@@ -85,26 +242,157 @@ public:
      */
     bool hangup();
 
+    /**
+     * 设置PPP链路配置, 在下一次拨号时生效
+     * @param profile 链路配置
+     */
+    void setPPPProfile(const PPPProfile &profile) { _pppProfile = profile; }
+
+    /**
+     * 获取PPP链路协商结果和线路统计
+     */
+    const PPPLinkStats &getPPPStats() const { return _pppStats; }
+
+    /**
+     * 拨号成功后是否把PPP接口设为默认路由, 默认开启
+     * @param enable 是否设为默认路由
+     */
+    void setDefaultRoute(bool enable) { _defaultRoute = enable; }
+
+    /**
+     * 立即把本调制解调器的PPP接口设为默认路由
+     * @return 是否成功
+     */
+    bool setDefault();
+
+    /**
+     * 获取PPP网络接口, 用于把连接绑定到指定链路
+     * @return 未连接时返回 nullptr
+     */
+    struct netif *getNetif();
+
+    /**
+     * PPP链路上次断开的时间(micros), 在协议栈报告断开时记录, 用于计算故障切换耗时
+     */
+    uint32_t linkLostAt() const { return _linkLostAt; }
+
+    /**
+     * 设置PPP抓包, 创建PPP接口时接管其输入/输出
+     * @param capture 抓包对象, nullptr 表示不抓包
+     */
+    void setCapture(PppCapture *capture);
+
+    /**
+     * 把串口收到的PPP数据交给协议栈, 数据模式下需要在主循环中持续调用
+     */
+    void poll();
+
     /**
      * 检查PPP连接状态
      * @return 是否连接正常且已分配IP地址
      */
     bool checkPPPStatus();
 
+    /**
+     * 激活模块内置协议栈的PDP上下文(AT+QIACT), 不进行PPP拨号
+     * PPP连接期间不可用, 拨号前自动去激活
+     * @param apn APN名称
+     * @return 是否成功
+     */
+    bool socketAttach(const char *apn);
+
+    /**
+     * 通过模块内置协议栈建立连接(AT+QIOPEN), 域名由模块解析
+     * @param id 连接号 0-11
+     * @param type TCP或UDP
+     * @param host 服务器域名或IP
+     * @param port 服务器端口
+     * @param timeout 等待连接结果的超时时间(ms)
+     * @return 是否连接成功
+     */
+    bool socketOpen(uint8_t id, ModemSocketType type, const char *host, uint16_t port, uint32_t timeout = 30000);
+
+    /**
+     * 发送数据(AT+QISEND), 超过单次上限时分多次发送
+     * @param id 连接号
+     * @param data 数据
+     * @param len 长度
+     * @return 模块是否全部接受(SEND OK)
+     */
+    bool socketSend(uint8_t id, const uint8_t *data, size_t len);
+
+    /**
+     * 读取已收到的数据(AT+QIRD), 不等待
+     * 同时处理 +QIURC: "recv"/"closed" 上报
+     * @param id 连接号
+     * @param buffer 输出缓冲区
+     * @param max 缓冲区大小
+     * @return 读取的字节数, 没有数据时返回0, 出错或对端已关闭且数据读完时返回-1
+     */
+    int socketRead(uint8_t id, uint8_t *buffer, size_t max);
+
+    /**
+     * 上次读空之后是否收到过新数据上报(+QIURC: "recv")
+     * @param id 连接号
+     */
+    bool socketReadable(uint8_t id) const { return _socketRecv & (1 << id); }
+
+    /**
+     * 关闭连接(AT+QICLOSE)
+     * @param id 连接号
+     */
+    void socketClose(uint8_t id);
+
 private:
-    HardwareSerial *_uart;    // 串口对象指针
+    const char *_name;        // 日志模块名和NVS命名空间
+    Stream *_uart;            // 串口对象指针(记录时指向_trace)
+    UartTrace _trace;         // 串口记录器
     bool _initialized;        // 初始化标志
+    int _connectCount;        // 连接尝试计数
 
     // PPP相关成员
     ppp_pcb *_ppp_pcb;       // 改名为_ppp_pcb以避免混淆
     struct netif _ppp_netif;  // PPP网络接口
     bool _ppp_connected;      // PPP连接状态
-    
+    volatile uint32_t _linkLostAt; // PPP链路上次断开的时间(micros)
+    volatile bool _pppPaused; // 命令模式期间丢弃协议栈的PPP输出
+    bool _defaultRoute;       // 拨号成功后设为默认路由
+    PPPProfile _pppProfile;   // PPP链路配置
+    PPPLinkStats _pppStats;   // PPP链路统计
+    PppCapture *_capture;     // PPP抓包
+    String _dialApn;          // 上次拨号的APN
+    String _dialUsername;     // 上次拨号的用户名
+    String _dialPassword;     // 上次拨号的密码
+
+    // 模块配置缓存
+    ModemProfile _profile;    // 缓存内容
+    bool _profileLoaded;      // 已从NVS读取
+    bool _profileWarm;        // 读取时缓存有效
+    bool _imeiChecked;        // 本次启动已核对缓存的IMEI
+    bool _tzReportSet;        // 本次运行已开启时区报告
+    uint32_t _bootToIpMs;     // 启动到获取IP的时间
+    bool _socketAttached;     // 内置协议栈的PDP上下文已激活
+    uint16_t _socketRecv;     // 按连接号记录的 +QIURC: "recv"
+    uint16_t _socketClosed;   // 按连接号记录的 +QIURC: "closed"
+
+    String _sendWithPrompt(const String &command, const uint8_t *data, size_t len, bool terminate,
+                           uint32_t timeout);
+    bool _waitFor(const String &text, uint32_t timeout, String &line);
+    void _readURC();
+    void _parseURC(const String &line);
+    void _saveProfile();
+    String _queryIMEI();
+    void _rememberOperator();
+    bool _selectCachedOperator();
+
     // PPP相关方法
     static u32_t _pppOutputCallback(ppp_pcb *pcb, u8_t *data, u32_t len, void *ctx);
     static void _pppLinkStatusCallback(ppp_pcb *pcb, int err_code, void *ctx);
-    void _pppInputTask();
-    bool _initPPP();
+    static void _pppPhaseCallback(ppp_pcb *pcb, u8_t phase, void *ctx);
+    void _pppInput();
+    void _applyPPPProfile();
+    void _onLinkStatus(ppp_pcb *pcb, int err_code);
+    bool _initPPP(const char *username, const char *password);
     void _cleanupPPP();
 
     /**
@@ -0,0 +1,75 @@
+#include "modemworker.h"
+#include "logger.h"
+
+ModemWorker::ModemWorker()
+    : _queue(nullptr), _task(nullptr), _idle(nullptr), _current(nullptr), _completed(0)
+{
+}
+
+bool ModemWorker::begin(uint32_t stackSize, UBaseType_t priority)
+{
+    if (_task)
+    {
+        return true;
+    }
+
+    _queue = xQueueCreate(QUEUE_LENGTH, sizeof(Item));
+    if (!_queue)
+    {
+        LOG_E("创建工作队列失败");
+        return false;
+    }
+
+    // 调制解调器等待时用 yield() 空转, 只让出给同优先级任务; 固定在 Arduino 核心上,
+    // 避免占满核心0使其空闲任务得不到运行而触发任务看门狗
+    if (xTaskCreatePinnedToCore(_run, "modem", stackSize, this, priority, &_task,
+                                ARDUINO_RUNNING_CORE) != pdPASS)
+    {
+        LOG_E("创建工作任务失败");
+        vQueueDelete(_queue);
+        _queue = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool ModemWorker::submit(const char *name, Job job, const String &args)
+{
+    if (!_queue)
+    {
+        return false;
+    }
+
+    Item item;
+    item.job = job;
+    item.name = name;
+    strncpy(item.args, args.c_str(), sizeof(item.args) - 1);
+    item.args[sizeof(item.args) - 1] = '\0';
+    return xQueueSend(_queue, &item, 0) == pdTRUE;
+}
+
+uint32_t ModemWorker::pending() const
+{
+    return _queue ? uxQueueMessagesWaiting(_queue) : 0;
+}
+
+void ModemWorker::_run(void *arg)
+{
+    ModemWorker *worker = (ModemWorker *)arg;
+    Item item;
+
+    while (true)
+    {
+        if (xQueueReceive(worker->_queue, &item, pdMS_TO_TICKS(10)) == pdTRUE)
+        {
+            worker->_current = item.name;
+            item.job(String(item.args));
+            worker->_current = nullptr;
+            worker->_completed++;
+        }
+        else if (worker->_idle)
+        {
+            worker->_idle();
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * 调制解调器工作任务
+ * 所有可能阻塞的调制解调器操作都在该任务中依次执行, 主循环不直接等待调制解调器
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+class ModemWorker
+{
+public:
+    typedef void (*Job)(const String &args);
+    typedef void (*IdleHandler)();
+
+    ModemWorker();
+
+    /**
+     * 创建工作任务, 与 loop() 运行在同一核心
+     * @param stackSize 任务栈大小
+     * @param priority 任务优先级
+     * @return 是否成功
+     */
+    bool begin(uint32_t stackSize = 8192, UBaseType_t priority = 1);
+
+    /**
+     * 设置空闲处理函数, 没有任务时周期调用(如处理PPP输入)
+     * @param idle 空闲处理函数
+     */
+    void setIdleHandler(IdleHandler idle) { _idle = idle; }
+
+    /**
+     * 提交任务, 立即返回
+     * @param name 任务名称(用于查询状态)
+     * @param job 任务函数
+     * @param args 任务参数
+     * @return false: 队列已满
+     */
+    bool submit(const char *name, Job job, const String &args = "");
+
+    /**
+     * 当前正在执行的任务名称, 空闲时返回 nullptr
+     */
+    const char *currentJob() const { return _current; }
+
+    /**
+     * 等待执行的任务数
+     */
+    uint32_t pending() const;
+
+    uint32_t completed() const { return _completed; }
+    TaskHandle_t handle() const { return _task; }
+
+private:
+    static const size_t QUEUE_LENGTH = 4;
+
+    struct Item
+    {
+        Job job;
+        const char *name;
+        char args[192];
+    };
+
+    static void _run(void *arg);
+
+    QueueHandle_t _queue;
+    TaskHandle_t _task;
+    IdleHandler _idle;
+    const char *volatile _current;
+    volatile uint32_t _completed;
+};
@@ -0,0 +1,522 @@
+#include "otaclient.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <lwip/sockets.h>
+
+#define OTA_NAMESPACE "ota"
+
+OtaClient::OtaClient()
+    : _partition(nullptr), _handle(0), _offset(0), _committed(0), _resumedFrom(0),
+      _throughput(0), _throttle(0), _retries(5), _idle(nullptr), _sock(-1), _rxPos(0), _rxLen(0)
+{
+}
+
+void OtaClient::_yield(uint32_t ms)
+{
+    if (_idle)
+    {
+        _idle();
+    }
+    delay(ms);
+}
+
+bool OtaClient::update(const char *host, uint16_t port, const char *path, size_t size, const uint8_t sha256[32])
+{
+    _partition = esp_ota_get_next_update_partition(NULL);
+    if (!_partition)
+    {
+        LOG_E("找不到OTA分区");
+        return false;
+    }
+    if (size == 0 || size > _partition->size)
+    {
+        LOG_E("固件大小无效: " + String(size));
+        return false;
+    }
+
+    // 按顺序写入时逐扇区擦除, 不预先擦除整个分区, 以免清掉已下载的部分
+    if (esp_ota_begin(_partition, OTA_WITH_SEQUENTIAL_WRITES, &_handle) != ESP_OK)
+    {
+        LOG_E("OTA初始化失败");
+        return false;
+    }
+    mbedtls_sha256_init(&_sha);
+    mbedtls_sha256_starts(&_sha, 0);
+
+    if (!_resume(sha256, size))
+    {
+        // 新的下载, 记录固件信息
+        _offset = 0;
+        Preferences prefs;
+        prefs.begin(OTA_NAMESPACE, false);
+        prefs.putBytes("sha", sha256, 32);
+        prefs.putUInt("size", size);
+        prefs.putUInt("off", 0);
+        prefs.end();
+    }
+    _committed = _offset;
+    _resumedFrom = _offset;
+    LOG_I("开始下载固件: " + String(size) + " 字节, 起始位置 " + String(_offset));
+
+    uint8_t attempt = 0;
+    // 重新开始OTA会话失败时 _handle 为0, 不再重试
+    while (_offset < size && attempt <= _retries && _handle)
+    {
+        uint32_t before = _offset;
+        if (_download(host, port, path, size))
+        {
+            break;
+        }
+
+        // 有进展时重新计数, 只有连续失败才放弃
+        attempt = (_offset > before) ? 1 : attempt + 1;
+        LOG_W("固件下载中断, 已完成 " + String(_offset) + "/" + String(size) + ", 第 " + String(attempt) + " 次重试");
+        unsigned long start = millis();
+        while (millis() - start < 2000)
+        {
+            _yield(10);
+        }
+    }
+
+    if (_offset < size)
+    {
+        // 已写入分区的数据保留, 下次续传时重新写入OTA会话
+        _commit();
+        esp_ota_abort(_handle);
+        mbedtls_sha256_free(&_sha);
+        LOG_E("固件下载失败, 下次从 " + String(_committed) + " 续传");
+        return false;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&_sha, digest);
+    mbedtls_sha256_free(&_sha);
+    if (memcmp(digest, sha256, 32) != 0)
+    {
+        LOG_E("固件校验失败");
+        esp_ota_abort(_handle);
+        _clear();
+        return false;
+    }
+
+    // 结束时校验镜像格式(和签名), 设置启动分区时再次校验
+    esp_err_t err = esp_ota_end(_handle);
+    if (err == ESP_OK)
+    {
+        err = esp_ota_set_boot_partition(_partition);
+    }
+    _clear();
+    if (err != ESP_OK)
+    {
+        LOG_E("固件镜像无效或设置启动分区失败: " + String(err));
+        return false;
+    }
+
+    LOG_I("固件更新完成, 重启后生效");
+    return true;
+}
+
+bool OtaClient::_resume(const uint8_t sha256[32], size_t size)
+{
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, true);
+    uint8_t saved[32];
+    bool match = prefs.getBytes("sha", saved, 32) == 32 &&
+                 memcmp(saved, sha256, 32) == 0 &&
+                 prefs.getUInt("size", 0) == size;
+    uint32_t offset = prefs.getUInt("off", 0);
+    prefs.end();
+
+    if (!match || offset > size)
+    {
+        return false;
+    }
+
+    // OTA会话只能从头顺序写入: 把已下载的完整扇区读出后重新写入, 同时重新计算哈希
+    // 写入每个扇区前会先擦除它, 因此整扇区读出后再写
+    uint32_t resumeAt = offset & ~(SECTOR_SIZE - 1);
+    uint8_t *buffer = (uint8_t *)malloc(SECTOR_SIZE);
+    if (!buffer)
+    {
+        return false;
+    }
+    _offset = 0;
+    while (_offset < resumeAt)
+    {
+        // 开启闪存加密时读出的是解密后的数据
+        if (esp_partition_read(_partition, _offset, buffer, SECTOR_SIZE) != ESP_OK ||
+            esp_ota_write(_handle, buffer, SECTOR_SIZE) != ESP_OK)
+        {
+            break;
+        }
+        mbedtls_sha256_update(&_sha, buffer, SECTOR_SIZE);
+        _offset += SECTOR_SIZE;
+        if (_idle)
+        {
+            _idle();
+        }
+    }
+    free(buffer);
+
+    if (_offset < resumeAt)
+    {
+        LOG_W("读取已下载的固件失败, 重新下载");
+        _restart();
+        return false;
+    }
+
+    LOG_I("续传固件下载, 已完成 " + String(_offset) + " 字节");
+    return true;
+}
+
+bool OtaClient::_download(const char *host, uint16_t port, const char *path, size_t size)
+{
+    if (!_connect(host, port))
+    {
+        LOG_E("连接固件服务器失败");
+        return false;
+    }
+
+    char request[256];
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\nHost: %s\r\nRange: bytes=%lu-\r\nConnection: close\r\n\r\n",
+                       path, host, (unsigned long)_offset);
+    int status;
+    if (len >= (int)sizeof(request) || !_send(request, len) || !_readHeaders(status, size))
+    {
+        _disconnect();
+        return false;
+    }
+
+    if (status == 200 && _offset > 0)
+    {
+        // 服务器不支持Range, 从头开始
+        LOG_W("服务器不支持续传, 重新下载");
+        if (!_restart())
+        {
+            _disconnect();
+            return false;
+        }
+        _committed = 0;
+    }
+
+    uint8_t buffer[CHUNK_SIZE];
+    uint32_t received = 0;
+    unsigned long start = millis();
+    unsigned long lastData = start;
+
+    while (_offset < size)
+    {
+        int n = _recv(buffer, min(sizeof(buffer), size - _offset));
+        if (n > 0)
+        {
+            if (!_write(buffer, n))
+            {
+                break;
+            }
+            received += n;
+            lastData = millis();
+
+            // 限速: 提前完成时等待, 期间调用空闲处理函数处理PPP输入
+            if (_throttle > 0)
+            {
+                uint32_t expected = (uint64_t)received * 1000 / _throttle;
+                while (millis() - start < expected)
+                {
+                    _yield(5);
+                }
+            }
+        }
+        else if (n < 0 || millis() - lastData > TIMEOUT)
+        {
+            break;
+        }
+        else
+        {
+            _yield();
+        }
+    }
+    _disconnect();
+
+    uint32_t elapsed = millis() - start;
+    if (elapsed > 0)
+    {
+        _throughput = (uint64_t)received * 1000 / elapsed;
+    }
+    return _offset >= size;
+}
+
+bool OtaClient::_readHeaders(int &status, size_t size)
+{
+    String line;
+    if (!_readLine(line) || sscanf(line.c_str(), "HTTP/%*s %d", &status) != 1)
+    {
+        return false;
+    }
+    if (status != 200 && status != 206)
+    {
+        LOG_E("固件服务器返回: " + line);
+        return false;
+    }
+
+    long rangeStart = -1;
+    unsigned long rangeTotal = 0;
+    long contentLength = -1;
+    bool chunked = false;
+    while (true)
+    {
+        if (!_readLine(line))
+        {
+            return false;
+        }
+        if (line.length() == 0)
+        {
+            break;
+        }
+        line.toLowerCase();
+        if (line.startsWith("content-range:"))
+        {
+            // 格式: bytes <起始>-<结束>/<总长度或*>
+            unsigned long first, last;
+            if (sscanf(line.c_str() + 14, " bytes %lu-%lu/%lu", &first, &last, &rangeTotal) >= 2)
+            {
+                rangeStart = first;
+            }
+        }
+        else if (line.startsWith("content-length:"))
+        {
+            contentLength = line.substring(15).toInt();
+        }
+        else if (line.startsWith("transfer-encoding:") && line.indexOf("chunked") > 0)
+        {
+            chunked = true;
+        }
+    }
+
+    if (chunked)
+    {
+        LOG_E("固件服务器使用分块传输编码, 不支持");
+        return false;
+    }
+
+    // 206必须从请求的位置开始, 否则数据会写到错误的位置
+    uint32_t offset = _offset;
+    if (status == 206)
+    {
+        if (rangeStart != (long)_offset || (rangeTotal != 0 && rangeTotal != size))
+        {
+            LOG_E("续传范围不符: 请求 " + String(_offset) + ", 返回 " + String(rangeStart) +
+                  "/" + String(rangeTotal));
+            return false;
+        }
+    }
+    else
+    {
+        offset = 0;
+    }
+    if (contentLength >= 0 && (size_t)contentLength != size - offset)
+    {
+        LOG_E("固件长度不符: " + String(contentLength));
+        return false;
+    }
+    return true;
+}
+
+bool OtaClient::_connect(const char *host, uint16_t port)
+{
+    ip4_addr_t addr;
+    _dns.setIdleHandler(_idle);
+    if (!_dns.resolve(host, addr, TIMEOUT))
+    {
+        return false;
+    }
+
+    _sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_sock < 0)
+    {
+        return false;
+    }
+    fcntl(_sock, F_SETFL, fcntl(_sock, F_GETFL, 0) | O_NONBLOCK);
+    _rxPos = _rxLen = 0;
+
+    struct sockaddr_in sa = {};
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_addr_from_ip4addr(&sa.sin_addr, &addr);
+    if (connect(_sock, (struct sockaddr *)&sa, sizeof(sa)) == 0)
+    {
+        return true;
+    }
+
+    // 等待连接完成, 期间处理PPP输入
+    unsigned long start = millis();
+    while (errno == EINPROGRESS && millis() - start < TIMEOUT)
+    {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(_sock, &fds);
+        struct timeval tv = {0, 0};
+        int ret = select(_sock + 1, nullptr, &fds, nullptr, &tv);
+        if (ret > 0)
+        {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(_sock, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+            {
+                return true;
+            }
+            break;
+        }
+        if (ret < 0)
+        {
+            break;
+        }
+        _yield();
+    }
+
+    _disconnect();
+    return false;
+}
+
+void OtaClient::_disconnect()
+{
+    if (_sock >= 0)
+    {
+        close(_sock);
+        _sock = -1;
+    }
+    _rxPos = _rxLen = 0;
+}
+
+bool OtaClient::_send(const char *data, size_t len)
+{
+    unsigned long start = millis();
+    size_t sent = 0;
+    while (sent < len)
+    {
+        int n = send(_sock, data + sent, len - sent, MSG_DONTWAIT);
+        if (n > 0)
+        {
+            sent += n;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && millis() - start < TIMEOUT)
+        {
+            _yield();
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int OtaClient::_recv(uint8_t *buffer, size_t max)
+{
+    if (_rxPos < _rxLen)
+    {
+        size_t n = min(max, _rxLen - _rxPos);
+        memcpy(buffer, _rx + _rxPos, n);
+        _rxPos += n;
+        return n;
+    }
+
+    int n = recv(_sock, buffer, max, MSG_DONTWAIT);
+    if (n > 0)
+    {
+        return n;
+    }
+    // 0: 连接已关闭
+    return (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? 0 : -1;
+}
+
+bool OtaClient::_readLine(String &line)
+{
+    line = "";
+    unsigned long start = millis();
+    while (millis() - start < TIMEOUT)
+    {
+        if (_rxPos >= _rxLen)
+        {
+            int n = _recv(_rx, sizeof(_rx));
+            if (n < 0)
+            {
+                return false;
+            }
+            if (n == 0)
+            {
+                _yield();
+                continue;
+            }
+            _rxPos = 0;
+            _rxLen = n;
+        }
+
+        char c = _rx[_rxPos++];
+        if (c == '\n')
+        {
+            line.trim();
+            return true;
+        }
+        line += c;
+    }
+    return false;
+}
+
+bool OtaClient::_restart()
+{
+    esp_ota_abort(_handle);
+    mbedtls_sha256_starts(&_sha, 0);
+    _offset = 0;
+    if (esp_ota_begin(_partition, OTA_WITH_SEQUENTIAL_WRITES, &_handle) != ESP_OK)
+    {
+        LOG_E("OTA初始化失败");
+        _handle = 0;
+        return false;
+    }
+    return true;
+}
+
+bool OtaClient::_write(const uint8_t *data, size_t len)
+{
+    // 按顺序写入, OTA接口负责擦除扇区和闪存加密
+    if (esp_ota_write(_handle, data, len) != ESP_OK)
+    {
+        LOG_E("写入OTA分区失败");
+        return false;
+    }
+
+    mbedtls_sha256_update(&_sha, data, len);
+    _offset += len;
+
+    if (_offset - _committed >= COMMIT_INTERVAL)
+    {
+        _commit();
+    }
+    return true;
+}
+
+void OtaClient::_commit()
+{
+    // 只提交完整扇区, 续传时重新擦除未完成的扇区
+    uint32_t committed = _offset & ~(SECTOR_SIZE - 1);
+    if (committed == _committed)
+    {
+        return;
+    }
+
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.putUInt("off", committed);
+    prefs.end();
+    _committed = committed;
+}
+
+void OtaClient::_clear()
+{
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.clear();
+    prefs.end();
+}
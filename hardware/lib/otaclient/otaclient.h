@@ -0,0 +1,94 @@
+/*
+ * 通过PPP链路的流式固件升级
+ * 分块下载固件并通过OTA接口顺序写入分区, 不缓存整个镜像, 支持闪存加密, 结束时校验镜像;
+ * 下载进度按扇区提交到NVS, 链路断开或重启后把已下载部分重新写入OTA会话, 再用HTTP Range请求续传
+ * 域名解析、连接和收发都不阻塞, 等待期间调用空闲处理函数处理PPP输入
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "dnsresolver.h"
+
+class OtaClient
+{
+public:
+    typedef void (*IdleHandler)();
+
+    OtaClient();
+
+    /**
+     * 限制下载速率, 给数据上报留出带宽
+     * @param bytesPerSecond 每秒字节数, 0表示不限速
+     */
+    void setThrottle(uint32_t bytesPerSecond) { _throttle = bytesPerSecond; }
+
+    /**
+     * 设置等待网络和限速暂停时调用的函数(如处理PPP输入), 不应在其中使用同一链路收发其他数据
+     * @param idle 空闲处理函数
+     */
+    void setIdleHandler(IdleHandler idle) { _idle = idle; }
+
+    /**
+     * 设置链路断开后的最大重试次数
+     * @param retries 重试次数
+     */
+    void setRetries(uint8_t retries) { _retries = retries; }
+
+    /**
+     * 下载固件并写入OTA分区, 成功后设置为下次启动分区
+     * 与上次未完成的下载使用相同的SHA-256时从已提交的位置续传
+     * @param host 服务器地址
+     * @param port 服务器端口
+     * @param path 固件路径
+     * @param size 固件大小
+     * @param sha256 固件SHA-256
+     * @return 是否成功, 成功后需重启生效
+     */
+    bool update(const char *host, uint16_t port, const char *path, size_t size, const uint8_t sha256[32]);
+
+    uint32_t offset() const { return _offset; }          // 已写入的字节数
+    uint32_t resumedFrom() const { return _resumedFrom; } // 本次续传的起始位置
+    uint32_t throughput() const { return _throughput; }  // 最近一次下载的平均速率(字节/秒)
+
+private:
+    static const size_t SECTOR_SIZE = 4096;
+    static const size_t CHUNK_SIZE = 1024;
+    static const uint32_t COMMIT_INTERVAL = 4 * SECTOR_SIZE;  // 进度提交间隔
+    static const uint32_t TIMEOUT = 30000;                    // 无数据超时(毫秒)
+
+    bool _resume(const uint8_t sha256[32], size_t size);
+    bool _download(const char *host, uint16_t port, const char *path, size_t size);
+    bool _readHeaders(int &status, size_t size);
+    bool _connect(const char *host, uint16_t port);
+    void _disconnect();
+    bool _send(const char *data, size_t len);
+    int _recv(uint8_t *buffer, size_t max);
+    bool _readLine(String &line);
+    void _yield(uint32_t ms = 1);
+    bool _restart();
+    bool _write(const uint8_t *data, size_t len);
+    void _commit();
+    void _clear();
+
+    const esp_partition_t *_partition;
+    esp_ota_handle_t _handle;
+    mbedtls_sha256_context _sha;
+    uint32_t _offset;
+    uint32_t _committed;     // 已提交到NVS的位置
+    uint32_t _resumedFrom;
+    uint32_t _throughput;
+
+    uint32_t _throttle;
+    uint8_t _retries;
+    IdleHandler _idle;
+
+    DnsResolver _dns;
+    int _sock;
+    // 读取响应头时多收到的数据, 在读取固件内容时先返回
+    uint8_t _rx[256];
+    size_t _rxPos;
+    size_t _rxLen;
+};
@@ -0,0 +1,339 @@
+#include "pppcapture.h"
+#include "logger.h"
+#include <sys/time.h>
+
+#define PCAP_MAGIC 0xA1B2C3D4
+#define LINKTYPE_RAW 101
+
+// HDLC帧
+#define PPP_FLAG 0x7E
+#define PPP_ESCAPE 0x7D
+#define PPP_TRANS 0x20
+#define PPP_GOOD_FCS 0xF0B8
+#define PPP_PROTOCOL_IP 0x0021
+
+// 同一时间只接管一个网络接口
+static PppCapture *_active = nullptr;
+
+PppCapture::PppCapture()
+    : _buf(nullptr), _size(0), _snapLen(96), _running(false), _netif(nullptr),
+      _origOutput(nullptr), _frameLen(0), _escape(false), _frameBad(true), _head(0), _tail(0), _end(0),
+      _wrapped(false), _count(0), _captured(0), _overwritten(0), _received(0), _sent(0), _overheadUs(0)
+{
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void PppCapture::begin(uint8_t *buffer, size_t size)
+{
+    _running = false;
+    _buf = buffer;
+    _size = size;
+    clear();
+}
+
+uint16_t PppCapture::setSnapLength(uint16_t len)
+{
+    // 单个包连同包头必须放得下, 否则永远不会被记录
+    if (_buf && len > _size - sizeof(Record))
+    {
+        len = _size > sizeof(Record) ? _size - sizeof(Record) : 0;
+    }
+    _snapLen = len;
+    return len;
+}
+
+void PppCapture::start()
+{
+    // 从下一个帧开始解帧
+    _frameLen = 0;
+    _escape = false;
+    _frameBad = true;
+    _running = _buf != nullptr;
+}
+
+void PppCapture::clear()
+{
+    portENTER_CRITICAL(&_lock);
+    _head = _tail = _end = 0;
+    _wrapped = false;
+    _count = 0;
+    _captured = 0;
+    _overwritten = 0;
+    _received = 0;
+    _sent = 0;
+    _overheadUs = 0;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void PppCapture::attach(struct netif *netif)
+{
+    if (_netif)
+    {
+        detach();
+    }
+    _active = this;
+    _netif = netif;
+    _origOutput = netif->output;
+    netif->output = _output;
+}
+
+void PppCapture::detach()
+{
+    if (!_netif)
+    {
+        return;
+    }
+    _netif->output = _origOutput;
+    _netif = nullptr;
+}
+
+err_t PppCapture::_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *addr)
+{
+    PppCapture *capture = _active;
+    if (capture->_running)
+    {
+        capture->_record(p, nullptr, p->tot_len, false);
+    }
+    return capture->_origOutput(netif, p, addr);
+}
+
+void PppCapture::input(const uint8_t *data, size_t len)
+{
+    if (!_running)
+    {
+        return;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = data[i];
+        if (c == PPP_FLAG)
+        {
+            if (!_frameBad && _frameLen > 0)
+            {
+                _frameEnd();
+            }
+            _frameLen = 0;
+            _escape = false;
+            _frameBad = false;
+            continue;
+        }
+        if (c == PPP_ESCAPE)
+        {
+            _escape = true;
+            continue;
+        }
+        if (_escape)
+        {
+            c ^= PPP_TRANS;
+            _escape = false;
+        }
+        if (_frameLen < MAX_FRAME)
+        {
+            _frame[_frameLen++] = c;
+        }
+        else
+        {
+            _frameBad = true;
+        }
+    }
+}
+
+// FCS-16, RFC 1662
+static uint16_t fcs16(const uint8_t *data, size_t len)
+{
+    uint16_t fcs = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        fcs ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            fcs = (fcs & 1) ? (fcs >> 1) ^ 0x8408 : fcs >> 1;
+        }
+    }
+    return fcs;
+}
+
+void PppCapture::_frameEnd()
+{
+    // 至少包含协议字段和2字节FCS
+    if (_frameLen < 3 || fcs16(_frame, _frameLen) != PPP_GOOD_FCS)
+    {
+        return;
+    }
+    const uint8_t *p = _frame;
+    size_t n = _frameLen - 2;
+
+    // 地址和控制字段可能被压缩(ACFC)
+    if (n >= 2 && p[0] == 0xFF && p[1] == 0x03)
+    {
+        p += 2;
+        n -= 2;
+    }
+    // 协议字段可能被压缩为1字节(PFC), 1字节协议号为奇数
+    uint16_t protocol;
+    if (n >= 1 && (p[0] & 1))
+    {
+        protocol = p[0];
+        p += 1;
+        n -= 1;
+    }
+    else if (n >= 2)
+    {
+        protocol = (p[0] << 8) | p[1];
+        p += 2;
+        n -= 2;
+    }
+    else
+    {
+        return;
+    }
+
+    if (protocol == PPP_PROTOCOL_IP && n > 0)
+    {
+        _record(nullptr, p, n, true);
+    }
+}
+
+size_t PppCapture::_next(size_t pos) const
+{
+    Record header;
+    memcpy(&header, _buf + pos, sizeof(header));
+    pos += sizeof(header) + header.capLen;
+    // 到达上一轮数据的结尾时回到开头
+    if (_wrapped && pos >= _end)
+    {
+        pos = 0;
+    }
+    return pos;
+}
+
+void PppCapture::_record(const struct pbuf *p, const uint8_t *data, uint16_t len, bool rx)
+{
+    uint32_t start = micros();
+
+    Record header;
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    header.sec = tv.tv_sec;
+    header.usec = tv.tv_usec;
+    header.origLen = len;
+    header.capLen = min(len, _snapLen);
+    size_t need = sizeof(header) + header.capLen;
+    if (need > _size)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    if (!_running)
+    {
+        // 导出期间不再写入
+        portEXIT_CRITICAL(&_lock);
+        return;
+    }
+    // 腾出空间: 未回绕时可用区间为 [_head, _size), 回绕后为 [_head, _tail)
+    for (;;)
+    {
+        if (_count == 0)
+        {
+            _head = _tail = 0;
+            _wrapped = false;
+        }
+        if (!_wrapped)
+        {
+            if (_head + need <= _size)
+            {
+                break;
+            }
+            // 末尾放不下, 从头开始
+            _end = _head;
+            _head = 0;
+            _wrapped = true;
+        }
+        if (_head + need <= _tail)
+        {
+            break;
+        }
+        // 覆盖最早的包; 上一轮的包全部覆盖后回到未回绕状态
+        _tail = _next(_tail);
+        if (_tail == 0)
+        {
+            _wrapped = false;
+        }
+        _count--;
+        _overwritten++;
+    }
+
+    memcpy(_buf + _head, &header, sizeof(header));
+    if (p)
+    {
+        pbuf_copy_partial(p, _buf + _head + sizeof(header), header.capLen, 0);
+    }
+    else
+    {
+        memcpy(_buf + _head + sizeof(header), data, header.capLen);
+    }
+    _head += need;
+    _count++;
+    _captured++;
+    if (rx)
+    {
+        _received++;
+    }
+    else
+    {
+        _sent++;
+    }
+    _overheadUs += micros() - start;
+    portEXIT_CRITICAL(&_lock);
+}
+
+size_t PppCapture::dump(Print &out)
+{
+    portENTER_CRITICAL(&_lock);
+    bool running = _running;
+    _running = false;
+    portEXIT_CRITICAL(&_lock);
+
+    static const char hex[] = "0123456789ABCDEF";
+    char line[65];
+    size_t n = 0;
+    size_t total = 0;
+    auto put = [&](const uint8_t *data, size_t len) {
+        for (size_t i = 0; i < len; i++)
+        {
+            line[n++] = hex[data[i] >> 4];
+            line[n++] = hex[data[i] & 0x0F];
+            if (n == 64)
+            {
+                line[n] = '\0';
+                out.println(line);
+                n = 0;
+            }
+        }
+        total += len;
+    };
+
+    // 文件头(小端)
+    uint32_t fileHeader[6] = {PCAP_MAGIC, 0x00040002, 0, 0, _snapLen, LINKTYPE_RAW};
+    put((const uint8_t *)fileHeader, sizeof(fileHeader));
+
+    size_t pos = _tail;
+    for (size_t i = 0; i < _count; i++)
+    {
+        Record header;
+        memcpy(&header, _buf + pos, sizeof(header));
+        uint32_t packetHeader[4] = {header.sec, header.usec, header.capLen, header.origLen};
+        put((const uint8_t *)packetHeader, sizeof(packetHeader));
+        put(_buf + pos + sizeof(header), header.capLen);
+        pos = _next(pos);
+    }
+    if (n > 0)
+    {
+        line[n] = '\0';
+        out.println(line);
+    }
+
+    _running = running;
+    return total;
+}
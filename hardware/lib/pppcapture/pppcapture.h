@@ -0,0 +1,135 @@
+/*
+ * PPP链路抓包
+ * 发送方向在PPP网络接口的输出函数处截取IP包; 接收方向lwIP直接把包交给ip4_input,
+ * 不经过网络接口的输入函数, 因此由Modem把串口收到的PPP数据交给 input() 自行解帧.
+ * 包带时间戳存入内存环形缓冲区, 缓冲区满时覆盖最早的包;
+ * 导出为pcap格式(LINKTYPE_RAW), 可直接用Wireshark打开
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <lwip/netif.h>
+
+class PppCapture
+{
+public:
+    PppCapture();
+
+    /**
+     * 设置缓冲区并清空已抓取的包
+     * @param buffer 缓冲区
+     * @param size 缓冲区大小
+     */
+    void begin(uint8_t *buffer, size_t size);
+
+    /**
+     * 设置每个包保存的最大字节数, 默认96(足够包含IP和TCP头)
+     * 超过缓冲区能容纳的长度时截短
+     * @param len 截取长度
+     * @return 实际使用的截取长度
+     */
+    uint16_t setSnapLength(uint16_t len);
+
+    /**
+     * 接管网络接口的输出函数, 由Modem在创建PPP接口时调用
+     * @param netif PPP网络接口
+     */
+    void attach(struct netif *netif);
+
+    /**
+     * 恢复网络接口原来的输出函数
+     */
+    void detach();
+
+    /**
+     * 处理串口收到的PPP数据(HDLC帧), 抓取其中FCS正确的IP包
+     * 由Modem在交给协议栈之前调用; VJ压缩的TCP包无法还原, 不抓取
+     * @param data 数据
+     * @param len 长度
+     */
+    void input(const uint8_t *data, size_t len);
+
+    /**
+     * 开始抓包
+     */
+    void start();
+
+    /**
+     * 停止抓包, 已抓取的包保留
+     */
+    void stop() { _running = false; }
+
+    bool isRunning() const { return _running; }
+
+    /**
+     * 清空已抓取的包
+     */
+    void clear();
+
+    /**
+     * 以十六进制文本输出pcap文件, 输出期间暂停抓包
+     * 主机端可用 xxd -r -p 还原
+     * @param out 输出流
+     * @return pcap文件长度
+     */
+    size_t dump(Print &out);
+
+    size_t packets() const { return _count; }          // 缓冲区中的包数
+    uint32_t captured() const { return _captured; }    // 累计抓取的包数
+    uint32_t overwritten() const { return _overwritten; }  // 被覆盖的包数
+    uint32_t received() const { return _received; }    // 累计抓取的接收方向包数
+    uint32_t sent() const { return _sent; }            // 累计抓取的发送方向包数
+
+    /**
+     * 平均每个包的抓取耗时(微秒)
+     */
+    float overhead() const { return _captured ? (float)_overheadUs / _captured : 0; }
+
+private:
+    // 缓冲区中的包头
+    struct Record
+    {
+        uint32_t sec;
+        uint32_t usec;
+        uint16_t origLen;
+        uint16_t capLen;
+    };
+
+    static const size_t MAX_FRAME = 1600;   // 解帧缓冲区, 容纳MRU 1500的帧
+
+    static err_t _output(struct netif *netif, struct pbuf *p, const ip4_addr_t *addr);
+    void _frameEnd();
+    // 记录一个包, p 为空时从 data 复制
+    void _record(const struct pbuf *p, const uint8_t *data, uint16_t len, bool rx);
+    size_t _next(size_t pos) const;
+
+    uint8_t *_buf;
+    size_t _size;
+    uint16_t _snapLen;
+    volatile bool _running;
+
+    struct netif *_netif;
+    netif_output_fn _origOutput;
+
+    // 接收方向解帧状态, 只在Modem的PPP输入中访问
+    uint8_t _frame[MAX_FRAME];
+    size_t _frameLen;
+    bool _escape;          // 上一个字节是转义符0x7D
+    bool _frameBad;        // 当前帧溢出或从中间开始, 丢弃
+
+    // 环形缓冲区: 包不跨越缓冲区末尾, 放不下时从头开始并覆盖最早的包
+    size_t _head;      // 下一个包的写入位置
+    size_t _tail;      // 最早的包的位置
+    size_t _end;       // 回绕后上一轮数据的结束位置
+    bool _wrapped;     // 写入位置已回绕到最早的包之前
+    size_t _count;
+
+    uint32_t _captured;
+    uint32_t _overwritten;
+    uint32_t _received;
+    uint32_t _sent;
+    uint32_t _overheadUs;
+
+    portMUX_TYPE _lock;
+};
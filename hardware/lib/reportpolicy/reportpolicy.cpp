@@ -0,0 +1,106 @@
+#include "reportpolicy.h"
+
+ReportPolicy::ReportPolicy()
+{
+    begin();
+}
+
+void ReportPolicy::begin(const ReportConfig &config)
+{
+    _config = config;
+    _started = false;
+    _moving = false;
+    _pending = false;
+    _reason = 0;
+    _interval = config.minInterval;
+    _rate = 0;
+    _last = {0, 0, 0};
+    _recorded = {0, 0, 0};
+    _pendingSince = 0;
+    _lastSend = 0;
+}
+
+void ReportPolicy::sent(uint32_t timestamp)
+{
+    _pending = false;
+    _lastSend = timestamp;
+}
+
+static inline int32_t absolute(int32_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+ReportAction ReportPolicy::add(const DepthSample &sample)
+{
+    if (!_started)
+    {
+        _started = true;
+        _last = sample;
+        _recorded = sample;
+        _lastSend = sample.timestamp;
+        _reason = REPORT_REASON_FIRST;
+        return REPORT_SEND;
+    }
+
+    // 速率估计: 与上一个采样的差值, 取一半旧值平滑单次噪声
+    uint32_t dt = sample.timestamp - _last.timestamp;
+    if (dt > 0)
+    {
+        int32_t raw = (int64_t)(sample.depth - _last.depth) * 60 / (int32_t)dt;
+        _rate = (_rate + raw) / 2;
+    }
+    _last = sample;
+
+    bool wasMoving = _moving;
+    // 停止判定门限取一半, 避免在门限附近反复切换
+    int32_t threshold = wasMoving ? _config.rateThreshold / 2 : _config.rateThreshold;
+    _moving = absolute(_rate) >= threshold;
+
+    _reason = 0;
+    if (_moving != wasMoving)
+    {
+        _reason |= REPORT_REASON_EVENT;
+    }
+    if (absolute(sample.depth - _recorded.depth) >= _config.deadband)
+    {
+        _reason |= REPORT_REASON_CHANGE;
+    }
+    if (_pending && sample.timestamp - _pendingSince >= _config.batchDelay)
+    {
+        _reason |= REPORT_REASON_BATCH;
+    }
+    if (sample.timestamp - _lastSend >= _config.heartbeat)
+    {
+        _reason |= REPORT_REASON_HEARTBEAT;
+    }
+
+    // 变化时按最短间隔采样, 静止时逐步延长
+    if (_moving || (_reason & REPORT_REASON_CHANGE))
+    {
+        _interval = _config.minInterval;
+    }
+    else if (_interval < _config.maxInterval)
+    {
+        _interval = _interval * 2 < _config.maxInterval ? _interval * 2 : _config.maxInterval;
+    }
+
+    if (_reason == 0)
+    {
+        return REPORT_SKIP;
+    }
+
+    _recorded = sample;
+    if (_reason & (REPORT_REASON_EVENT | REPORT_REASON_BATCH | REPORT_REASON_HEARTBEAT))
+    {
+        sent(sample.timestamp);
+        return REPORT_SEND;
+    }
+
+    if (!_pending)
+    {
+        _pending = true;
+        _pendingSince = sample.timestamp;
+    }
+    return REPORT_RECORD;
+}
@@ -0,0 +1,110 @@
+/*
+ * 液位上报策略
+ *
+ * 位于采样和上行之间, 决定每个采样是否记录、是否立即发送, 以及下一次采样的间隔:
+ *   - 液位相对上次记录的变化超过死区时记录
+ *   - 液位变化速率超过门限(加注、抽取)时按最短间隔采样, 事件开始和结束时立即发送
+ *   - 液位静止时采样间隔逐步加倍, 直到最长间隔
+ *   - 超过心跳间隔没有发送时强制发送一次
+ *
+ * 不依赖 Arduino, 主机端可直接编译用于回放液位记录.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "depthcodec.h"
+
+struct ReportConfig
+{
+    int32_t deadband;        // 液位死区(0.1毫米)
+    int32_t rateThreshold;   // 变化速率门限(0.1毫米/分钟)
+    uint32_t minInterval;    // 最短采样间隔(秒)
+    uint32_t maxInterval;    // 最长采样间隔(秒)
+    uint32_t batchDelay;     // 已记录采样的最长等待发送时间(秒)
+    uint32_t heartbeat;      // 最长发送间隔(秒)
+
+    /**
+     * 默认配置: 死区5毫米, 速率门限10毫米/分钟, 采样间隔10秒到2分钟,
+     * 记录最多等待15分钟, 心跳6小时
+     */
+    static ReportConfig defaults()
+    {
+        return {50, 100, 10, 120, 900, 6 * 3600};
+    }
+};
+
+// 处理结果
+enum ReportAction
+{
+    REPORT_SKIP,     // 丢弃该采样
+    REPORT_RECORD,   // 记录该采样, 随下一次发送上传
+    REPORT_SEND      // 记录该采样并立即发送
+};
+
+// 处理原因, 可组合
+#define REPORT_REASON_FIRST     0x01   // 首个采样
+#define REPORT_REASON_CHANGE    0x02   // 超出死区
+#define REPORT_REASON_EVENT     0x04   // 加注/抽取开始或结束
+#define REPORT_REASON_BATCH     0x08   // 记录等待时间到
+#define REPORT_REASON_HEARTBEAT 0x10   // 心跳
+
+class ReportPolicy
+{
+public:
+    ReportPolicy();
+
+    /**
+     * 设置配置并清除状态
+     * @param config 上报配置
+     */
+    void begin(const ReportConfig &config = ReportConfig::defaults());
+
+    /**
+     * 处理一个采样
+     * @param sample 采样, 时间戳必须递增
+     * @return 处理结果
+     */
+    ReportAction add(const DepthSample &sample);
+
+    /**
+     * 距下一次采样的时间(秒)
+     */
+    uint32_t nextInterval() const { return _interval; }
+
+    /**
+     * 最近一次处理的原因 REPORT_REASON_*
+     */
+    uint8_t reason() const { return _reason; }
+
+    /**
+     * 当前是否处于加注/抽取状态
+     */
+    bool moving() const { return _moving; }
+
+    /**
+     * 当前的变化速率估计(0.1毫米/分钟)
+     */
+    int32_t rate() const { return _rate; }
+
+    /**
+     * 外部完成发送后调用(如其他数据触发了连接), 顺带发送的记录不再计入等待
+     * @param timestamp 发送时间(秒)
+     */
+    void sent(uint32_t timestamp);
+
+private:
+    ReportConfig _config;
+
+    bool _started;
+    bool _moving;
+    bool _pending;           // 有已记录但未发送的采样
+    uint8_t _reason;
+    uint32_t _interval;
+    int32_t _rate;           // 平滑后的变化速率
+
+    DepthSample _last;       // 上一个采样
+    DepthSample _recorded;   // 上一个记录的采样
+    uint32_t _pendingSince;  // 最早未发送记录的时间
+    uint32_t _lastSend;
+};
@@ -0,0 +1,224 @@
+#include "serialbridge.h"
+#include "logger.h"
+
+static_assert((SerialBridge::BUFFER_SIZE & (SerialBridge::BUFFER_SIZE - 1)) == 0,
+              "BUFFER_SIZE必须是2的幂");
+
+#define RING_INDEX(x) ((x) & (SerialBridge::BUFFER_SIZE - 1))
+
+size_t SerialBridge::Ring::fill(HardwareSerial &from)
+{
+    int avail = from.available();
+    if (avail <= 0)
+    {
+        return 0;
+    }
+
+    // 只读取到缓冲区末尾, 剩余部分在下一轮读取
+    size_t space = BUFFER_SIZE - used();
+    size_t contiguous = BUFFER_SIZE - RING_INDEX(head);
+    size_t n = min(min(space, contiguous), (size_t)avail);
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    n = from.read(data + RING_INDEX(head), n);
+    head += n;
+    return n;
+}
+
+size_t SerialBridge::Ring::drain(HardwareSerial &to)
+{
+    int room = to.availableForWrite();
+    if (room <= 0 || used() == 0)
+    {
+        return 0;
+    }
+
+    size_t contiguous = BUFFER_SIZE - RING_INDEX(tail);
+    size_t n = min(min(used(), contiguous), (size_t)room);
+    n = to.write(data + RING_INDEX(tail), n);
+    tail += n;
+    total += n;
+    return n;
+}
+
+SerialBridge::SerialBridge(HardwareSerial &host, HardwareSerial &modem)
+    : _host(host), _modem(modem), _lastHostRx(0), _escapeCount(0), _pendingBaud(0)
+{
+}
+
+void SerialBridge::run()
+{
+    LOG_I("进入透明桥接模式, 静默1秒后发送 ~~~ 退出");
+    _host.flush();
+
+    // 其他任务的日志会混入转发给PC的数据
+    LogLevel level = LOGGER.getLogLevel();
+    LOG_LEVEL(LogLevel::NONE);
+
+    _up.head = _up.tail = _up.total = 0;
+    _down.head = _down.tail = _down.total = 0;
+    _lastHostRx = millis();
+    _escapeCount = 0;
+    _pendingBaud = 0;
+    _hostLine.len = 0;
+    _modemLine.len = 0;
+
+    while (true)
+    {
+        uint32_t now = millis();
+        bool idle = now - _lastHostRx >= GUARD_TIME;
+
+        size_t up = _up.fill(_host);
+        if (up > 0)
+        {
+            _trackEscape(up, idle);
+            _lastHostRx = now;
+            _checkBaud(_up, up, true);
+        }
+        else if (_escapeCount > 0 && idle)
+        {
+            if (_escapeCount == 3)
+            {
+                // 退出序列后静默1秒, 丢弃退出序列并退出
+                _up.head -= 3;
+                break;
+            }
+            // 不是退出序列(如单独的HDLC帧标志0x7E), 照常转发
+            _escapeCount = 0;
+        }
+
+        size_t down = _down.fill(_modem);
+        if (down > 0)
+        {
+            _checkBaud(_down, down, false);
+        }
+
+        size_t moved = _down.drain(_host);
+        if (_escapeCount == 0)
+        {
+            // 可能是退出序列时暂不转发
+            moved += _up.drain(_modem);
+        }
+
+        if (up == 0 && down == 0 && moved == 0)
+        {
+            vTaskDelay(1);
+        }
+        else
+        {
+            taskYIELD();
+        }
+    }
+
+    // 转发剩余数据
+    while (_up.used() > 0)
+    {
+        _up.drain(_modem);
+    }
+    while (_down.used() > 0)
+    {
+        _down.drain(_host);
+    }
+
+    LOG_LEVEL(level);
+    LOG_I("退出透明桥接模式, 上行 " + String(_up.total) + " 字节, 下行 " + String(_down.total) + " 字节");
+}
+
+void SerialBridge::_trackEscape(size_t received, bool idle)
+{
+    // 只有静默后的新数据或正在等待的退出序列才逐字节检查
+    if (!idle && _escapeCount == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < received; i++)
+    {
+        if (_up.data[RING_INDEX(_up.head - received + i)] != '~')
+        {
+            _escapeCount = 0;
+            return;
+        }
+    }
+
+    _escapeCount += received;
+    if (_escapeCount > 3)
+    {
+        _escapeCount = 0;
+    }
+}
+
+bool SerialBridge::Line::add(uint8_t c)
+{
+    if (c == '\r' || c == '\n')
+    {
+        bool complete = len > 0 && len < LINE_SIZE;
+        text[complete ? len : 0] = '\0';
+        len = 0;
+        return complete;
+    }
+    if (len < LINE_SIZE - 1)
+    {
+        text[len++] = toupper(c);
+    }
+    else
+    {
+        len = LINE_SIZE;
+    }
+    return false;
+}
+
+void SerialBridge::_checkBaud(Ring &ring, size_t received, bool fromHost)
+{
+    // 应答只在等待确认期间检查
+    if (!fromHost && !_pendingBaud)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < received; i++)
+    {
+        uint8_t c = ring.data[RING_INDEX(ring.head - received + i)];
+        if (fromHost)
+        {
+            // 可能与其他指令合并在一行, 如 AT+CSQ;+IPR=921600
+            const char *ipr;
+            if (_hostLine.add(c) && strncmp(_hostLine.text, "AT", 2) == 0 &&
+                (ipr = strstr(_hostLine.text, "+IPR=")) != nullptr)
+            {
+                _pendingBaud = strtoul(ipr + 5, nullptr, 10);
+                _modemLine.len = 0;
+            }
+        }
+        else if (_modemLine.add(c))
+        {
+            if (strcmp(_modemLine.text, "OK") == 0)
+            {
+                _switchBaud(ring);
+                return;
+            }
+            if (strstr(_modemLine.text, "ERROR"))
+            {
+                _pendingBaud = 0;
+                return;
+            }
+        }
+    }
+}
+
+void SerialBridge::_switchBaud(Ring &ring)
+{
+    // 先把应答按旧波特率送到PC, 再同时切换两侧串口
+    while (ring.used() > 0)
+    {
+        ring.drain(_host);
+    }
+    _host.flush();
+    _modem.flush();
+    _modem.updateBaudRate(_pendingBaud);
+    _host.updateBaudRate(_pendingBaud);
+    _pendingBaud = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * USB串口与调制解调器串口之间的透明桥接
+ * 用于PC端诊断工具和模块升级工具直接访问调制解调器
+ *
+ * 退出方式: 静默1秒后在1秒内发送"~~~", 再静默1秒; 不足三个'~'时在静默1秒后照常转发
+ * 桥接期间暂停日志输出, 以免混入转发的数据流
+ * 波特率跟随: PC发送 AT+IPR=<波特率> 且调制解调器返回 OK 后, 两侧串口同时切换;
+ * 指令和应答按行识别, 可以跨越多次读取
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class SerialBridge
+{
+public:
+    static const size_t BUFFER_SIZE = 2048;
+
+    SerialBridge(HardwareSerial &host, HardwareSerial &modem);
+
+    /**
+     * 进入桥接模式, 直到收到退出序列才返回
+     * 调用期间两个串口都由桥接独占, 应在调制解调器工作任务中调用
+     */
+    void run();
+
+    uint32_t hostToModem() const { return _up.total; }   // PC -> 调制解调器字节数
+    uint32_t modemToHost() const { return _down.total; } // 调制解调器 -> PC字节数
+
+private:
+    static const uint32_t GUARD_TIME = 1000;
+    static const size_t LINE_SIZE = 32;
+
+    // 按行收集文本, 用于识别指令和应答
+    struct Line
+    {
+        char text[LINE_SIZE];
+        size_t len;        // 超过 LINE_SIZE 时丢弃到行尾
+
+        bool add(uint8_t c);
+    };
+
+    // 单向环形缓冲区
+    struct Ring
+    {
+        uint8_t data[BUFFER_SIZE];
+        size_t head;     // 写入位置
+        size_t tail;     // 读取位置
+        uint32_t total;  // 累计转发字节数
+
+        size_t used() const { return head - tail; }
+        size_t fill(HardwareSerial &from);
+        size_t drain(HardwareSerial &to);
+    };
+
+    void _trackEscape(size_t received, bool idle);
+    void _checkBaud(Ring &ring, size_t received, bool fromHost);
+    void _switchBaud(Ring &ring);
+
+    HardwareSerial &_host;
+    HardwareSerial &_modem;
+    Ring _up;
+    Ring _down;
+
+    uint32_t _lastHostRx;     // PC最后一次发送数据的时间
+    size_t _escapeCount;      // 静默后连续收到的'~'个数, 暂不转发
+    uint32_t _pendingBaud;    // 等待调制解调器确认的新波特率
+    Line _hostLine;           // PC发送的当前行
+    Line _modemLine;          // 等待确认期间调制解调器返回的当前行
+};
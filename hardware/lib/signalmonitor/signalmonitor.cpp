@@ -0,0 +1,196 @@
+#include "signalmonitor.h"
+#include "logger.h"
+
+SignalMonitor::SignalMonitor(Modem &modem)
+    : _modem(modem), _interval(60000), _maxDelay(15 * 60000),
+      _rssiThreshold(-95), _rsrpThreshold(-110), _cesqSupported(true),
+      _attempted(false), _lastAttempt(0), _head(0), _count(0)
+{
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void SignalMonitor::setThreshold(int16_t rssi, int16_t rsrp)
+{
+    _rssiThreshold = rssi;
+    _rsrpThreshold = rsrp;
+}
+
+bool SignalMonitor::sample(bool force)
+{
+    if (!force && _attempted && millis() - _lastAttempt < _interval)
+    {
+        return false;
+    }
+
+    if (_modem.checkPPPStatus())
+    {
+        return false;
+    }
+
+    // 模块无响应时也要等待一个间隔再查询, 避免空闲时反复发送指令
+    _attempted = true;
+    _lastAttempt = millis();
+
+    SignalSample s;
+    s.time = millis();
+    s.rssi = SIGNAL_UNKNOWN;
+    s.ber = 99;
+    s.rsrp = SIGNAL_UNKNOWN;
+    s.rsrq = SIGNAL_UNKNOWN;
+
+    if (!_parseCSQ(_modem.sendCommand("AT+CSQ"), s))
+    {
+        LOG_W("信号质量查询失败");
+        return false;
+    }
+
+    if (_cesqSupported)
+    {
+        String response = _modem.sendCommand("AT+CESQ");
+        if (response.indexOf("ERROR") >= 0)
+        {
+            // 模块不支持时不再查询
+            _cesqSupported = false;
+        }
+        else
+        {
+            _parseCESQ(response, s);
+        }
+    }
+
+    portENTER_CRITICAL(&_lock);
+    _history[_head] = s;
+    _head = (_head + 1) % HISTORY_SIZE;
+    if (_count < HISTORY_SIZE)
+    {
+        _count++;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    LOG_D("信号: RSSI " + String(s.rssi) + "dBm, BER " + String(s.ber) +
+          ", RSRP " + String(s.rsrp) + "dBm, RSRQ " + String(s.rsrq) + "dB");
+    return true;
+}
+
+bool SignalMonitor::latest(SignalSample &out) const
+{
+    portENTER_CRITICAL(&_lock);
+    bool found = _count > 0;
+    if (found)
+    {
+        out = _history[(_head + HISTORY_SIZE - 1) % HISTORY_SIZE];
+    }
+    portEXIT_CRITICAL(&_lock);
+    return found;
+}
+
+size_t SignalMonitor::history(SignalSample *out, size_t max) const
+{
+    portENTER_CRITICAL(&_lock);
+    size_t n = min(max, _count);
+    size_t start = (_head + HISTORY_SIZE - n) % HISTORY_SIZE;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = _history[(start + i) % HISTORY_SIZE];
+    }
+    portEXIT_CRITICAL(&_lock);
+    return n;
+}
+
+bool SignalMonitor::isGood() const
+{
+    int32_t rssiSum = 0, rsrpSum = 0;
+    int rssiCount = 0, rsrpCount = 0;
+
+    portENTER_CRITICAL(&_lock);
+    for (size_t i = 0; i < min(_count, AVERAGE_COUNT); i++)
+    {
+        const SignalSample &s = _history[(_head + HISTORY_SIZE - 1 - i) % HISTORY_SIZE];
+        if (s.rssi != SIGNAL_UNKNOWN)
+        {
+            rssiSum += s.rssi;
+            rssiCount++;
+        }
+        if (s.rsrp != SIGNAL_UNKNOWN)
+        {
+            rsrpSum += s.rsrp;
+            rsrpCount++;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    // LTE下RSRP比RSSI更能反映链路质量
+    if (rsrpCount > 0)
+    {
+        return rsrpSum / rsrpCount >= _rsrpThreshold;
+    }
+    if (rssiCount > 0)
+    {
+        return rssiSum / rssiCount >= _rssiThreshold;
+    }
+    // 没有有效采样时不推迟
+    return true;
+}
+
+bool SignalMonitor::shouldDefer(uint32_t queuedAt, bool urgent)
+{
+    if (urgent || millis() - queuedAt >= _maxDelay)
+    {
+        return false;
+    }
+
+    sample();
+    return !isGood();
+}
+
+bool SignalMonitor::_parseCSQ(const String &response, SignalSample &sample)
+{
+    // 格式: +CSQ: <rssi>,<ber>
+    int pos = response.indexOf("+CSQ:");
+    if (pos < 0)
+    {
+        return false;
+    }
+
+    int rssi, ber;
+    if (sscanf(response.c_str() + pos, "+CSQ: %d,%d", &rssi, &ber) != 2)
+    {
+        return false;
+    }
+
+    // 0: -113dBm, 31: -51dBm, 99: 未知
+    if (rssi >= 0 && rssi <= 31)
+    {
+        sample.rssi = -113 + 2 * rssi;
+    }
+    sample.ber = (uint8_t)ber;
+    return true;
+}
+
+bool SignalMonitor::_parseCESQ(const String &response, SignalSample &sample)
+{
+    // 格式: +CESQ: <rxlev>,<ber>,<rscp>,<ecno>,<rsrq>,<rsrp>
+    int pos = response.indexOf("+CESQ:");
+    if (pos < 0)
+    {
+        return false;
+    }
+
+    int rxlev, ber, rscp, ecno, rsrq, rsrp;
+    if (sscanf(response.c_str() + pos, "+CESQ: %d,%d,%d,%d,%d,%d",
+               &rxlev, &ber, &rscp, &ecno, &rsrq, &rsrp) != 6)
+    {
+        return false;
+    }
+
+    // RSRQ 0: -19.5dB, 34: -3dB; RSRP 0: -140dBm, 97: -44dBm; 255: 未知
+    if (rsrq >= 0 && rsrq <= 34)
+    {
+        sample.rsrq = (int16_t)((rsrq - 40) / 2);
+    }
+    if (rsrp >= 0 && rsrp <= 97)
+    {
+        sample.rsrp = (int16_t)(-141 + rsrp);
+    }
+    return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * 信号质量采样与发送调度
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "modem.h"
+
+// 单次信号质量采样
+struct SignalSample
+{
+    uint32_t time;   // 采样时间(millis)
+    int16_t rssi;    // 接收信号强度(dBm), 未知时为 SIGNAL_UNKNOWN
+    uint8_t ber;     // 误码率等级 0-7, 未知时为 99
+    int16_t rsrp;    // LTE参考信号接收功率(dBm), 未知时为 SIGNAL_UNKNOWN
+    int16_t rsrq;    // LTE参考信号接收质量(dB), 未知时为 SIGNAL_UNKNOWN
+};
+
+#define SIGNAL_UNKNOWN INT16_MIN
+
+class SignalMonitor
+{
+public:
+    /**
+     * @param modem 调制解调器
+     */
+    explicit SignalMonitor(Modem &modem);
+
+    /**
+     * 设置最小采样间隔, 间隔内的采样请求直接返回缓存; 查询失败也按该间隔重试
+     * @param ms 采样间隔(毫秒)
+     */
+    void setInterval(uint32_t ms) { _interval = ms; }
+
+    /**
+     * 设置信号良好的门限
+     * @param rssi RSSI门限(dBm)
+     * @param rsrp RSRP门限(dBm), 仅在模块支持 AT+CESQ 时使用
+     */
+    void setThreshold(int16_t rssi, int16_t rsrp);
+
+    /**
+     * 设置非紧急数据的最长推迟时间
+     * @param ms 最长推迟时间(毫秒)
+     */
+    void setMaxDelay(uint32_t ms) { _maxDelay = ms; }
+
+    /**
+     * 采样信号质量(AT+CSQ, 支持时追加 AT+CESQ)
+     * PPP连接期间不采样, 避免为查询信号退出数据模式
+     * @param force 忽略采样间隔
+     * @return 是否产生了新的采样
+     */
+    bool sample(bool force = false);
+
+    /**
+     * 复制最近一次采样, 可在采样任务之外调用
+     * @param out 输出采样
+     * @return 是否有采样
+     */
+    bool latest(SignalSample &out) const;
+
+    /**
+     * 按时间顺序复制采样历史, 可在采样任务之外调用
+     * @param out 输出数组
+     * @param max 数组大小
+     * @return 复制的采样数
+     */
+    size_t history(SignalSample *out, size_t max) const;
+
+    /**
+     * 最近几次采样的平均信号是否达到门限
+     */
+    bool isGood() const;
+
+    /**
+     * 发送前调用, 判断是否应推迟本次发送
+     * @param queuedAt 数据开始等待发送的时间(millis)
+     * @param urgent 是否为紧急数据, 紧急数据从不推迟
+     * @return true: 推迟发送, false: 立即发送
+     */
+    bool shouldDefer(uint32_t queuedAt, bool urgent = false);
+
+private:
+    static constexpr size_t HISTORY_SIZE = 32;
+    static constexpr size_t AVERAGE_COUNT = 3;
+
+    bool _parseCSQ(const String &response, SignalSample &sample);
+    bool _parseCESQ(const String &response, SignalSample &sample);
+
+    Modem &_modem;
+    uint32_t _interval;
+    uint32_t _maxDelay;
+    int16_t _rssiThreshold;
+    int16_t _rsrpThreshold;
+    bool _cesqSupported;
+    bool _attempted;         // 是否查询过
+    uint32_t _lastAttempt;   // 最近一次查询的时间, 无论成功与否
+
+    SignalSample _history[HISTORY_SIZE];
+    size_t _head;   // 下一次写入的位置
+    size_t _count;
+
+    // 采样在工作任务中写入, 命令行在主循环中读取
+    mutable portMUX_TYPE _lock;
+};
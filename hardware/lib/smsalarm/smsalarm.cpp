@@ -0,0 +1,184 @@
+#include "smsalarm.h"
+#include "logger.h"
+
+#define HOUR_MS 3600000UL
+
+SmsAlarm::SmsAlarm(Modem &modem)
+    : _modem(modem), _dedupWindow(10 * 60000), _rateLimit(6), _retries(3), _retryDelay(30000),
+      _pduMode(false), _count(0), _recentCount(0), _sentHead(0), _sentCount(0), _stats()
+{
+    _recipient[0] = '\0';
+}
+
+void SmsAlarm::setRecipient(const char *number)
+{
+    strncpy(_recipient, number, sizeof(_recipient) - 1);
+    _recipient[sizeof(_recipient) - 1] = '\0';
+}
+
+void SmsAlarm::setRetries(uint8_t retries, uint32_t delay)
+{
+    _retries = retries;
+    _retryDelay = delay;
+}
+
+bool SmsAlarm::raise(uint8_t code, const char *text)
+{
+    uint32_t now = millis();
+
+    // 去重: 窗口内已产生过同一告警
+    Recent *recent = nullptr;
+    for (size_t i = 0; i < _recentCount; i++)
+    {
+        if (_recent[i].code == code)
+        {
+            recent = &_recent[i];
+            break;
+        }
+    }
+    if (recent && now - recent->time < _dedupWindow)
+    {
+        _stats.suppressed++;
+        return false;
+    }
+
+    if (_count >= QUEUE_SIZE)
+    {
+        LOG_W("告警队列已满, 丢弃告警 " + String(code));
+        _stats.dropped++;
+        return false;
+    }
+
+    if (!recent)
+    {
+        if (_recentCount < RECENT_SIZE)
+        {
+            recent = &_recent[_recentCount++];
+        }
+        else
+        {
+            // 替换最早的记录
+            recent = &_recent[0];
+            for (size_t i = 1; i < RECENT_SIZE; i++)
+            {
+                if (now - _recent[i].time > now - recent->time)
+                {
+                    recent = &_recent[i];
+                }
+            }
+        }
+        recent->code = code;
+    }
+    recent->time = now;
+
+    Alarm &alarm = _queue[_count++];
+    alarm.code = code;
+    alarm.attempts = 0;
+    alarm.raised = now;
+    alarm.nextAttempt = now;
+    strncpy(alarm.text, text, MAX_TEXT);
+    alarm.text[MAX_TEXT] = '\0';
+    LOG_I("产生告警 " + String(code) + ": " + alarm.text);
+    return true;
+}
+
+void SmsAlarm::poll()
+{
+    if (_count == 0 || !_recipient[0])
+    {
+        return;
+    }
+
+    // 队列按产生时间排列, 只处理最早的告警
+    Alarm &alarm = _queue[0];
+    uint32_t now = millis();
+    if ((int32_t)(now - alarm.nextAttempt) < 0 || _rateLimited())
+    {
+        return;
+    }
+
+    if (_send(alarm))
+    {
+        _stats.sent++;
+        _stats.lastLatency = millis() - alarm.raised;
+        _sentAt[_sentHead] = millis();
+        _sentHead = (_sentHead + 1) % RATE_WINDOW;
+        if (_sentCount < RATE_WINDOW)
+        {
+            _sentCount++;
+        }
+        LOG_I("告警短信已发送, 耗时 " + String(_stats.lastLatency) + " ms");
+        _remove(0);
+        return;
+    }
+
+    if (++alarm.attempts > _retries)
+    {
+        LOG_E("告警短信发送失败, 放弃告警 " + String(alarm.code));
+        _stats.failed++;
+        _remove(0);
+        return;
+    }
+    alarm.nextAttempt = millis() + (_retryDelay << (alarm.attempts - 1));
+    LOG_W("告警短信发送失败, 第 " + String(alarm.attempts) + " 次重试");
+}
+
+bool SmsAlarm::_rateLimited()
+{
+    uint32_t now = millis();
+    size_t recent = 0;
+    for (size_t i = 0; i < _sentCount; i++)
+    {
+        if (now - _sentAt[i] < HOUR_MS)
+        {
+            recent++;
+        }
+    }
+    return recent >= _rateLimit;
+}
+
+void SmsAlarm::_remove(size_t index)
+{
+    for (size_t i = index + 1; i < _count; i++)
+    {
+        _queue[i - 1] = _queue[i];
+    }
+    _count--;
+}
+
+bool SmsAlarm::_send(const Alarm &alarm)
+{
+    String pdu;
+    size_t tpduLen = SmsPdu::encode(_recipient, alarm.text, pdu);
+    if (tpduLen == 0)
+    {
+        LOG_E("告警号码无效: " + String(_recipient));
+        return false;
+    }
+
+    // PPP连接期间临时退出数据模式
+    bool resume = _modem.checkPPPStatus();
+
+    bool ok = true;
+    if (!_pduMode)
+    {
+        ok = _modem.sendCommand("AT+CMGF=0").indexOf("OK") >= 0;
+        _pduMode = ok;
+    }
+    if (ok)
+    {
+        String response = _modem.sendCommandWithData("AT+CMGS=" + String(tpduLen), pdu, 60000);
+        ok = response.indexOf("+CMGS:") >= 0;
+        if (!ok && response.indexOf("ERROR") >= 0)
+        {
+            // 模块可能已复位, 下次重新设置PDU模式
+            _pduMode = false;
+        }
+    }
+
+    if (resume)
+    {
+        _modem.setDataMode();
+    }
+    return ok;
+}
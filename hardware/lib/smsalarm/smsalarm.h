@@ -0,0 +1,121 @@
+/*
+ * 短信告警通道
+ * 不建立PPP连接, 直接通过AT指令以PDU模式(AT+CMGS)发送告警短信,
+ * 对相同告警去重, 限制发送频率, 失败时按退避间隔重试
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "modem.h"
+#include "smspdu.h"
+
+// 告警通道统计
+struct SmsAlarmStats
+{
+    uint32_t sent;          // 发送成功的告警数
+    uint32_t failed;        // 重试后仍失败而放弃的告警数
+    uint32_t suppressed;    // 去重窗口内被忽略的告警数
+    uint32_t dropped;       // 待发送队列已满而丢弃的告警数
+    uint32_t lastLatency;   // 最近一次从产生告警到发送成功的时间(毫秒)
+};
+
+class SmsAlarm
+{
+public:
+    static const size_t MAX_TEXT = SmsPdu::MAX_TEXT;
+
+    /**
+     * @param modem 调制解调器
+     */
+    explicit SmsAlarm(Modem &modem);
+
+    /**
+     * 设置接收号码
+     * @param number 号码, 国际格式以+开头, 最长20位
+     */
+    void setRecipient(const char *number);
+
+    /**
+     * 设置同一告警的去重窗口, 窗口内重复产生的告警被忽略
+     * @param ms 去重窗口(毫秒)
+     */
+    void setDedupWindow(uint32_t ms) { _dedupWindow = ms; }
+
+    /**
+     * 设置发送频率限制
+     * @param perHour 每小时最多发送的短信数, 不超过 RATE_WINDOW
+     */
+    void setRateLimit(uint8_t perHour) { _rateLimit = min<uint8_t>(perHour, RATE_WINDOW); }
+
+    /**
+     * 设置重试
+     * @param retries 失败后的重试次数
+     * @param delay 首次重试的等待时间(毫秒), 之后每次加倍
+     */
+    void setRetries(uint8_t retries, uint32_t delay);
+
+    /**
+     * 产生告警, 只加入待发送队列, 由 poll() 发送
+     * @param code 告警代码, 用于去重
+     * @param text 告警内容, 仅支持ASCII, 超过 MAX_TEXT 的部分被截断
+     * @return false: 被去重忽略或队列已满
+     */
+    bool raise(uint8_t code, const char *text);
+
+    /**
+     * 发送到期的告警, 应在调制解调器空闲时调用(工作任务中)
+     * PPP连接期间会暂时切换到命令模式发送(期间暂停PPP输出), 发送后恢复数据模式
+     */
+    void poll();
+
+    /**
+     * 待发送的告警数
+     */
+    size_t pending() const { return _count; }
+
+    const SmsAlarmStats &stats() const { return _stats; }
+
+private:
+    static const size_t QUEUE_SIZE = 4;
+    static const size_t RECENT_SIZE = 8;   // 去重时记录的告警代码个数
+    static const size_t RATE_WINDOW = 8;   // 记录的最近发送时间个数, 也是每小时的上限
+
+    struct Alarm
+    {
+        uint8_t code;
+        uint8_t attempts;
+        uint32_t raised;        // 产生时间
+        uint32_t nextAttempt;   // 下次尝试时间
+        char text[MAX_TEXT + 1];
+    };
+
+    bool _send(const Alarm &alarm);
+    bool _rateLimited();
+    void _remove(size_t index);
+
+    Modem &_modem;
+    char _recipient[24];
+    uint32_t _dedupWindow;
+    uint8_t _rateLimit;
+    uint8_t _retries;
+    uint32_t _retryDelay;
+    bool _pduMode;              // 已设置 AT+CMGF=0
+
+    Alarm _queue[QUEUE_SIZE];
+    size_t _count;
+
+    // 最近产生的告警代码和时间, 用于去重
+    struct Recent
+    {
+        uint8_t code;
+        uint32_t time;
+    };
+    Recent _recent[RECENT_SIZE];
+    size_t _recentCount;
+
+    uint32_t _sentAt[RATE_WINDOW];   // 最近发送时间, 环形
+    size_t _sentHead;
+    size_t _sentCount;
+
+    SmsAlarmStats _stats;
+};
@@ -0,0 +1,109 @@
+#include "smspdu.h"
+
+// 半字节交换的十进制号码
+static bool appendSemiOctets(String &out, const char *digits)
+{
+    size_t n = strlen(digits);
+    for (size_t i = 0; i < n; i += 2)
+    {
+        char low = digits[i];
+        char high = i + 1 < n ? digits[i + 1] : 'F';
+        if (!isdigit(low) || (high != 'F' && !isdigit(high)))
+        {
+            return false;
+        }
+        out += high;
+        out += low;
+    }
+    return true;
+}
+
+// ASCII到GSM 7位默认字母表, 需要扩展表的字符替换为'?'
+static uint8_t toGsm7(char c)
+{
+    switch (c)
+    {
+    case '@':
+        return 0x00;
+    case '$':
+        return 0x02;
+    case '_':
+        return 0x11;
+    case '\n':
+        return 0x0A;
+    case '\r':
+        return 0x0D;
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '\\':
+    case '^':
+    case '~':
+    case '|':
+    case '`':
+        return '?';
+    default:
+        return (c >= 0x20 && c < 0x7F) ? c : '?';
+    }
+}
+
+size_t SmsPdu::encode(const char *number, const char *text, String &pdu)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    auto putByte = [&](uint8_t b) {
+        pdu += hex[b >> 4];
+        pdu += hex[b & 0x0F];
+    };
+
+    bool international = number[0] == '+';
+    const char *digits = international ? number + 1 : number;
+    size_t digitCount = strlen(digits);
+    if (digitCount == 0 || digitCount > 20)
+    {
+        return 0;
+    }
+
+    size_t septets = strlen(text);
+    if (septets > MAX_TEXT)
+    {
+        septets = MAX_TEXT;
+    }
+
+    pdu = "";
+    pdu.reserve(2 + 2 * (7 + (digitCount + 1) / 2 + (septets * 7 + 7) / 8));
+    putByte(0x00);                         // 使用模块中保存的短信中心
+    putByte(0x01);                         // SMS-SUBMIT, 无有效期
+    putByte(0x00);                         // 消息参考号由模块分配
+    putByte(digitCount);                   // 号码位数
+    putByte(international ? 0x91 : 0x81);  // 号码类型
+    if (!appendSemiOctets(pdu, digits))
+    {
+        return 0;
+    }
+    putByte(0x00);                         // 协议标识
+    putByte(0x00);                         // GSM 7位编码
+    putByte(septets);
+
+    // 每个字符7位, 低位在前依次打包
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (size_t i = 0; i < septets; i++)
+    {
+        bits |= (uint32_t)toGsm7(text[i]) << bitCount;
+        bitCount += 7;
+        while (bitCount >= 8)
+        {
+            putByte(bits & 0xFF);
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+    if (bitCount > 0)
+    {
+        putByte(bits & 0xFF);
+    }
+
+    // AT+CMGS的长度不含短信中心字节
+    return pdu.length() / 2 - 1;
+}
@@ -0,0 +1,22 @@
+/*
+ * 短信PDU编码
+ * 把ASCII文本编码为SMS-SUBMIT PDU(GSM 7位默认字母表), 用于AT+CMGS
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class SmsPdu
+{
+public:
+    static const size_t MAX_TEXT = 160;   // GSM 7位编码单条短信的最大字符数
+
+    /**
+     * 把文本编码为SMS-SUBMIT PDU(不含短信中心地址), GSM 7位默认字母表
+     * @param number 接收号码, 国际格式以+开头, 最长20位
+     * @param text 文本, 仅支持ASCII, 超过 MAX_TEXT 的部分被截断
+     * @param pdu 输出十六进制字符串
+     * @return TPDU字节数(AT+CMGS的参数), 失败返回0
+     */
+    static size_t encode(const char *number, const char *text, String &pdu);
+};
@@ -0,0 +1,435 @@
+#include "storequeue.h"
+#include "logger.h"
+#include <esp_rom_crc.h>
+
+#define RECORD_MAGIC 0xA5
+#define RECORD_HEADER 7
+
+StoreQueue::StoreQueue(fs::FS &fs, const char *dir)
+    : _fs(fs), _dir(dir), _segmentSize(32 * 1024), _maxSegments(16),
+      _firstSegment(1), _writeSegment(1), _writeOffset(0), _pageLen(0),
+      _readSegment(1), _readOffset(0), _readFileSegment(0),
+      _commitSegment(1), _commitOffset(0), _generation(0), _dropped(0)
+{
+}
+
+bool StoreQueue::begin(size_t segmentSize, uint32_t maxSegments)
+{
+    _segmentSize = segmentSize;
+    _maxSegments = maxSegments < 2 ? 2 : maxSegments;
+    _pageLen = 0;
+
+    if (!_fs.exists(_dir) && !_fs.mkdir(_dir))
+    {
+        LOG_E("创建队列目录失败: " + _dir);
+        return false;
+    }
+
+    // 扫描已有的段文件
+    uint32_t minSegment = UINT32_MAX, maxSegment = 0;
+    File root = _fs.open(_dir);
+    if (!root || !root.isDirectory())
+    {
+        LOG_E("打开队列目录失败: " + _dir);
+        return false;
+    }
+    for (File f = root.openNextFile(); f; f = root.openNextFile())
+    {
+        String name = f.name();
+        name = name.substring(name.lastIndexOf('/') + 1);
+        if (!name.endsWith(".seg"))
+        {
+            continue;
+        }
+        uint32_t segment = strtoul(name.c_str(), nullptr, 10);
+        if (segment == 0)
+        {
+            continue;
+        }
+        minSegment = min(minSegment, segment);
+        maxSegment = max(maxSegment, segment);
+    }
+    root.close();
+
+    bool hasCursor = _loadCursor();
+
+    // 掉电前的写入段尾部可能不完整, 总是从新段开始写入
+    _writeSegment = maxSegment + 1;
+    if (hasCursor && _commitSegment > _writeSegment)
+    {
+        _writeSegment = _commitSegment;
+    }
+    _writeOffset = 0;
+    _firstSegment = (minSegment == UINT32_MAX) ? _writeSegment : minSegment;
+
+    if (!hasCursor || _commitSegment < _firstSegment)
+    {
+        _commitSegment = _firstSegment;
+        _commitOffset = 0;
+    }
+    _skipConsumed(_commitSegment, _commitOffset);
+
+    rewind();
+    _compact();
+
+    LOG_I("队列已恢复: 段 " + String(_firstSegment) + "-" + String(_writeSegment) +
+          ", 游标 " + String(_commitSegment) + ":" + String(_commitOffset));
+    return true;
+}
+
+bool StoreQueue::append(const uint8_t *data, size_t len)
+{
+    if (len == 0 || len > MAX_RECORD)
+    {
+        LOG_E("记录长度无效: " + String(len));
+        return false;
+    }
+
+    uint8_t header[RECORD_HEADER];
+    uint32_t crc = esp_rom_crc32_le(0, data, len);
+    header[0] = RECORD_MAGIC;
+    header[1] = len & 0xFF;
+    header[2] = len >> 8;
+    memcpy(header + 3, &crc, 4);
+
+    if (_pageLen + RECORD_HEADER + len > PAGE_SIZE && !flush())
+    {
+        return false;
+    }
+
+    if (RECORD_HEADER + len > PAGE_SIZE)
+    {
+        // 大记录直接写入闪存
+        File f = _fs.open(_segmentPath(_writeSegment), FILE_APPEND);
+        if (!f)
+        {
+            return false;
+        }
+        bool ok = f.write(header, RECORD_HEADER) == RECORD_HEADER && f.write(data, len) == len;
+        f.close();
+        if (!ok)
+        {
+            return false;
+        }
+        _writeOffset += RECORD_HEADER + len;
+        return flush();
+    }
+
+    memcpy(_page + _pageLen, header, RECORD_HEADER);
+    memcpy(_page + _pageLen + RECORD_HEADER, data, len);
+    _pageLen += RECORD_HEADER + len;
+    return true;
+}
+
+bool StoreQueue::flush()
+{
+    if (_pageLen > 0)
+    {
+        File f = _fs.open(_segmentPath(_writeSegment), FILE_APPEND);
+        if (!f)
+        {
+            LOG_E("打开段文件失败");
+            return false;
+        }
+        size_t written = f.write(_page, _pageLen);
+        f.close();
+        if (written != _pageLen)
+        {
+            LOG_E("写入段文件失败");
+            return false;
+        }
+        _writeOffset += _pageLen;
+        _pageLen = 0;
+    }
+
+    // 读取句柄不一定能看到其他句柄追加的数据, 下次读取时重新打开
+    if (_readFile && _readFileSegment == _writeSegment)
+    {
+        _readFile.close();
+    }
+
+    if (_writeOffset >= _segmentSize)
+    {
+        _writeSegment++;
+        _writeOffset = 0;
+        _enforceCapacity();
+    }
+    return true;
+}
+
+size_t StoreQueue::read(uint8_t *out, size_t max)
+{
+    while (true)
+    {
+        if (_readSegment >= _writeSegment)
+        {
+            // 读到写入段时先把页缓冲写入闪存, 只读取已写入的部分, 写入段保持打开
+            // 写满后才换段, 避免每次上传都产生一个小段而提前触发段数上限
+            if (_pageLen > 0 && !flush())
+            {
+                return 0;
+            }
+            if (_readSegment >= _writeSegment && _readOffset >= _writeOffset)
+            {
+                return 0;
+            }
+        }
+
+        if (!_openRead(_readSegment))
+        {
+            if (!_nextReadSegment())
+            {
+                return 0;
+            }
+            continue;
+        }
+
+        uint8_t header[RECORD_HEADER];
+        if (_readFile.seek(_readOffset) &&
+            _readFile.read(header, RECORD_HEADER) == RECORD_HEADER &&
+            header[0] == RECORD_MAGIC)
+        {
+            size_t len = header[1] | (header[2] << 8);
+            uint32_t crc;
+            memcpy(&crc, header + 3, 4);
+            if (len > max && len <= MAX_RECORD)
+            {
+                // 输出缓冲区放不下, 读取位置不变
+                return 0;
+            }
+            if (len > 0 && len <= max && _readFile.read(out, len) == len &&
+                esp_rom_crc32_le(0, out, len) == crc)
+            {
+                _readOffset += RECORD_HEADER + len;
+                return len;
+            }
+        }
+
+        // 段结束或尾部损坏(掉电时写入未完成), 转到下一段
+        if (!_nextReadSegment())
+        {
+            return 0;
+        }
+    }
+}
+
+size_t StoreQueue::readBatch(uint8_t *out, size_t max, uint32_t &count)
+{
+    size_t pos = 0;
+    count = 0;
+    while (max - pos > 2)
+    {
+        size_t len = read(out + pos + 2, max - pos - 2);
+        if (len == 0)
+        {
+            break;
+        }
+        out[pos] = len >> 8;
+        out[pos + 1] = len & 0xFF;
+        pos += 2 + len;
+        count++;
+    }
+    return pos;
+}
+
+bool StoreQueue::commit()
+{
+    if (_commitSegment == _readSegment && _commitOffset == _readOffset)
+    {
+        return true;
+    }
+
+    _skipConsumed(_readSegment, _readOffset);
+
+    uint32_t segment = _commitSegment, offset = _commitOffset;
+    _commitSegment = _readSegment;
+    _commitOffset = _readOffset;
+    if (!_saveCursor())
+    {
+        _commitSegment = segment;
+        _commitOffset = offset;
+        return false;
+    }
+
+    _compact();
+    return true;
+}
+
+void StoreQueue::rewind()
+{
+    _readSegment = _commitSegment;
+    _readOffset = _commitOffset;
+}
+
+bool StoreQueue::empty() const
+{
+    return _pageLen == 0 && _commitSegment >= _writeSegment && _commitOffset >= _writeOffset;
+}
+
+String StoreQueue::_segmentPath(uint32_t segment) const
+{
+    char name[16];
+    snprintf(name, sizeof(name), "/%08lu.seg", (unsigned long)segment);
+    return _dir + name;
+}
+
+String StoreQueue::_cursorPath(uint32_t slot) const
+{
+    return _dir + "/cursor" + String(slot);
+}
+
+bool StoreQueue::_loadCursor()
+{
+    bool found = false;
+    for (uint32_t slot = 0; slot < 2; slot++)
+    {
+        File f = _fs.open(_cursorPath(slot), FILE_READ);
+        if (!f)
+        {
+            continue;
+        }
+        Cursor c;
+        bool ok = f.read((uint8_t *)&c, sizeof(c)) == sizeof(c);
+        f.close();
+        if (!ok || c.crc != esp_rom_crc32_le(0, (const uint8_t *)&c, offsetof(Cursor, crc)))
+        {
+            LOG_W("游标文件损坏: " + _cursorPath(slot));
+            continue;
+        }
+        if (!found || c.generation > _generation)
+        {
+            _generation = c.generation;
+            _commitSegment = c.segment;
+            _commitOffset = c.offset;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool StoreQueue::_saveCursor()
+{
+    Cursor c;
+    c.generation = _generation + 1;
+    c.segment = _commitSegment;
+    c.offset = _commitOffset;
+    c.crc = esp_rom_crc32_le(0, (const uint8_t *)&c, offsetof(Cursor, crc));
+
+    // 交替写入两个游标文件, 写入过程中掉电时另一份仍然有效
+    File f = _fs.open(_cursorPath(c.generation % 2), FILE_WRITE);
+    if (!f)
+    {
+        LOG_E("打开游标文件失败");
+        return false;
+    }
+    bool ok = f.write((const uint8_t *)&c, sizeof(c)) == sizeof(c);
+    f.close();
+    if (ok)
+    {
+        _generation = c.generation;
+    }
+    return ok;
+}
+
+bool StoreQueue::_openRead(uint32_t segment)
+{
+    if (_readFile && _readFileSegment == segment)
+    {
+        return true;
+    }
+    if (_readFile)
+    {
+        _readFile.close();
+    }
+
+    String path = _segmentPath(segment);
+    if (!_fs.exists(path))
+    {
+        return false;
+    }
+    _readFile = _fs.open(path, FILE_READ);
+    _readFileSegment = segment;
+    return (bool)_readFile;
+}
+
+bool StoreQueue::_nextReadSegment()
+{
+    if (_readSegment >= _writeSegment)
+    {
+        return false;
+    }
+    _readSegment++;
+    _readOffset = 0;
+    return true;
+}
+
+void StoreQueue::_skipConsumed(uint32_t &segment, uint32_t &offset)
+{
+    // 跳过已读完的封存段, 使游标尽量指向下一条未读记录
+    while (segment < _writeSegment)
+    {
+        String path = _segmentPath(segment);
+        if (_fs.exists(path))
+        {
+            File f = _fs.open(path, FILE_READ);
+            size_t size = f ? f.size() : 0;
+            f.close();
+            if (size > offset)
+            {
+                return;
+            }
+        }
+        segment++;
+        offset = 0;
+    }
+}
+
+void StoreQueue::_compact()
+{
+    while (_firstSegment < _commitSegment)
+    {
+        if (_readFile && _readFileSegment == _firstSegment)
+        {
+            _readFile.close();
+        }
+        String path = _segmentPath(_firstSegment);
+        if (_fs.exists(path))
+        {
+            _fs.remove(path);
+        }
+        _firstSegment++;
+    }
+}
+
+void StoreQueue::_enforceCapacity()
+{
+    bool moved = false;
+    while (_writeSegment - _firstSegment + 1 > _maxSegments)
+    {
+        // 长时间无法上传时丢弃最早的数据
+        if (_commitSegment <= _firstSegment)
+        {
+            _commitSegment = _firstSegment + 1;
+            _commitOffset = 0;
+            moved = true;
+        }
+        if (_readSegment <= _firstSegment)
+        {
+            _readSegment = _firstSegment + 1;
+            _readOffset = 0;
+        }
+        if (_readFile && _readFileSegment == _firstSegment)
+        {
+            _readFile.close();
+        }
+        _fs.remove(_segmentPath(_firstSegment));
+        _firstSegment++;
+        _dropped++;
+        LOG_W("队列已满, 丢弃最早的段");
+    }
+
+    if (moved)
+    {
+        _saveCursor();
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * 闪存持久化的存储转发队列
+ *
+ * 记录追加写入按序号命名的段文件, 每条记录带CRC校验:
+ *   0xA5 | 长度(2字节) | CRC32(4字节) | 数据
+ * 消费位置在上传被确认后才提交, 两个游标文件交替写入, 掉电时至少保留一份有效游标.
+ * 非线程安全, 所有调用应在同一任务中进行.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+class StoreQueue
+{
+public:
+    static const size_t MAX_RECORD = 1024;   // 单条记录最大长度
+    static const size_t PAGE_SIZE = 512;     // 批量写入的页大小
+
+    /**
+     * @param fs 文件系统(LittleFS/SPIFFS等)
+     * @param dir 队列目录
+     */
+    StoreQueue(fs::FS &fs, const char *dir = "/queue");
+
+    /**
+     * 打开队列并从上次掉电中恢复
+     * @param segmentSize 单个段文件大小上限(字节)
+     * @param maxSegments 段文件数量上限, 超出时丢弃最早的段
+     * @return 是否成功
+     */
+    bool begin(size_t segmentSize = 32 * 1024, uint32_t maxSegments = 16);
+
+    /**
+     * 追加一条记录(先写入页缓冲, 页满时写入闪存)
+     * @param data 数据
+     * @param len 长度, 不超过 MAX_RECORD
+     * @return 是否成功
+     */
+    bool append(const uint8_t *data, size_t len);
+
+    /**
+     * 把页缓冲写入闪存
+     * @return 是否成功
+     */
+    bool flush();
+
+    /**
+     * 从读取位置读出一条记录, 读取位置随之前进, 但不会提交
+     * 读到最新的记录时先把页缓冲写入闪存, 写入段不因读取而结束
+     * @param out 输出缓冲区, 至少 MAX_RECORD 字节时总能读出下一条记录
+     * @param max 缓冲区大小
+     * @return 记录长度, 没有记录或缓冲区放不下下一条记录时返回0(读取位置不变)
+     */
+    size_t read(uint8_t *out, size_t max);
+
+    /**
+     * 从读取位置读出尽可能多的完整记录, 用于合并成一次上传, 读取位置随之前进但不会提交
+     * 每条记录前加2字节长度(大端), 放不下的记录留到下一批
+     * @param out 输出缓冲区
+     * @param max 缓冲区大小
+     * @param count 输出读出的记录数
+     * @return 写入的字节数, 没有记录或第一条记录放不下时返回0
+     */
+    size_t readBatch(uint8_t *out, size_t max, uint32_t &count);
+
+    /**
+     * 上传被确认后调用, 提交读取位置并删除已消费的段
+     * @return 是否成功
+     */
+    bool commit();
+
+    /**
+     * 上传失败时调用, 读取位置回到上次提交的位置
+     */
+    void rewind();
+
+    /**
+     * 是否还有未提交的记录
+     */
+    bool empty() const;
+
+    uint32_t droppedSegments() const { return _dropped; }
+
+private:
+    struct Cursor
+    {
+        uint32_t generation;
+        uint32_t segment;
+        uint32_t offset;
+        uint32_t crc;
+    };
+
+    String _segmentPath(uint32_t segment) const;
+    String _cursorPath(uint32_t slot) const;
+    bool _loadCursor();
+    bool _saveCursor();
+    bool _openRead(uint32_t segment);
+    bool _nextReadSegment();
+    void _skipConsumed(uint32_t &segment, uint32_t &offset);
+    void _compact();
+    void _enforceCapacity();
+
+    fs::FS &_fs;
+    String _dir;
+    size_t _segmentSize;
+    uint32_t _maxSegments;
+
+    uint32_t _firstSegment;   // 最早仍存在的段
+    uint32_t _writeSegment;   // 当前写入的段
+    uint32_t _writeOffset;    // 当前写入段已写入闪存的字节数
+    uint8_t _page[PAGE_SIZE];
+    size_t _pageLen;
+
+    uint32_t _readSegment;
+    uint32_t _readOffset;
+    File _readFile;
+    uint32_t _readFileSegment;
+
+    uint32_t _commitSegment;
+    uint32_t _commitOffset;
+    uint32_t _generation;
+    uint32_t _dropped;
+};
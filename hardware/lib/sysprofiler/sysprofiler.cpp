@@ -0,0 +1,302 @@
+#include "sysprofiler.h"
+#include "logger.h"
+
+#define RECORD_VERSION 1
+
+// 判断最大块持续减小所用的采样数和降幅
+#define SHRINK_WINDOW 8
+#define SHRINK_PERCENT 10
+
+SysProfiler::SysProfiler()
+    : _interval(10000), _minHeap(20 * 1024), _minStack(512), _maxCpu(900), _overhead(0),
+      _head(0), _count(0), _status(nullptr), _prev(nullptr), _current(nullptr), _capacity(0),
+      _taskCount(0), _prevCount(0), _prevTotal(0)
+{
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+SysProfiler::~SysProfiler()
+{
+    free(_status);
+    free(_prev);
+    free(_current);
+}
+
+void SysProfiler::setThreshold(uint32_t minHeap, uint32_t minStack, uint16_t maxCpu)
+{
+    _minHeap = minHeap;
+    _minStack = minStack;
+    _maxCpu = maxCpu;
+}
+
+bool SysProfiler::sample(bool force)
+{
+    // 只有采样任务写入, 读取自身数据无需加锁
+    const ResourceSample *last = _latest();
+    if (!force && last && millis() - last->time < _interval)
+    {
+        return false;
+    }
+
+    uint32_t start = micros();
+
+    ResourceSample s = {};
+    s.time = millis();
+    s.freeHeap = ESP.getFreeHeap();
+    s.minFreeHeap = ESP.getMinFreeHeap();
+    s.largestBlock = ESP.getMaxAllocHeap();
+    s.fragmentation = s.freeHeap ? 100 - (uint64_t)s.largestBlock * 100 / s.freeHeap : 0;
+    size_t taskCount = _sampleTasks(s);
+
+    uint8_t previous = last ? last->flags : 0;
+    s.flags = _checkFlags(s);
+
+    portENTER_CRITICAL(&_lock);
+    memcpy(_tasks, _sampling, taskCount * sizeof(TaskProfile));
+    _taskCount = taskCount;
+    _history[_head] = s;
+    _head = (_head + 1) % HISTORY_SIZE;
+    if (_count < HISTORY_SIZE)
+    {
+        _count++;
+    }
+    portEXIT_CRITICAL(&_lock);
+    _overhead = micros() - start;
+
+    // 只在出现新的告警时输出
+    uint8_t raised = s.flags & ~previous;
+    if (raised & PROFILE_HEAP_SHRINKING)
+    {
+        LOG_W("最大可分配块持续减小: " + String(s.largestBlock) + " 字节");
+    }
+    if (raised & PROFILE_HEAP_LOW)
+    {
+        LOG_W("空闲堆过低: " + String(s.freeHeap) + " 字节");
+    }
+    if (raised & PROFILE_STACK_LOW)
+    {
+        LOG_W("任务栈余量过低: " + String(s.minStack) + " 字节");
+    }
+    if (raised & PROFILE_CPU_HIGH)
+    {
+        LOG_W("CPU占用过高: " + String(s.cpuLoad / 10.0, 1) + "%");
+    }
+    return true;
+}
+
+bool SysProfiler::_reserve(size_t count)
+{
+    // 分配失败的缓冲区保持原大小, 容量只在全部成功时增大
+    TaskStatus_t *status = (TaskStatus_t *)realloc(_status, count * sizeof(TaskStatus_t));
+    if (status)
+    {
+        _status = status;
+    }
+    RunTime *prev = (RunTime *)realloc(_prev, count * sizeof(RunTime));
+    if (prev)
+    {
+        _prev = prev;
+    }
+    RunTime *current = (RunTime *)realloc(_current, count * sizeof(RunTime));
+    if (current)
+    {
+        _current = current;
+    }
+    if (!status || !prev || !current)
+    {
+        LOG_E("任务采样缓冲区分配失败");
+        return false;
+    }
+    _capacity = count;
+    return true;
+}
+
+size_t SysProfiler::_sampleTasks(ResourceSample &s)
+{
+#if configUSE_TRACE_FACILITY
+    // 按当前任务数分配, 多留几个位置给采样前新建的任务
+    UBaseType_t needed = uxTaskGetNumberOfTasks() + 4;
+    if (needed > _capacity)
+    {
+        _reserve(needed);
+    }
+
+    uint32_t total = 0;
+    UBaseType_t n = _capacity ? uxTaskGetSystemState(_status, _capacity, &total) : 0;
+    if (n == 0)
+    {
+        // 缓冲区分配失败或任务数仍超过容量, 只记录当前任务, 以免栈余量为0误报告警
+        s.minStack = uxTaskGetStackHighWaterMark(NULL);
+        return 0;
+    }
+
+    uint32_t elapsed = (total - _prevTotal) * portNUM_PROCESSORS;
+    uint32_t idle = 0;
+
+    s.minStack = UINT16_MAX;
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        const TaskStatus_t &status = _status[i];
+        TaskProfile task;
+        strncpy(task.name, status.pcTaskName, sizeof(task.name) - 1);
+        task.name[sizeof(task.name) - 1] = '\0';
+        task.stackFree = status.usStackHighWaterMark;
+        s.minStack = min<uint32_t>(s.minStack, task.stackFree);
+
+        task.cpu = 0;
+        _current[i] = {status.xHandle, status.ulRunTimeCounter};
+#if configGENERATE_RUN_TIME_STATS
+        // 与上次采样时同一任务的运行时间差
+        for (size_t j = 0; j < _prevCount && _prevTotal; j++)
+        {
+            if (_prev[j].handle == status.xHandle && elapsed > 0)
+            {
+                uint32_t ran = status.ulRunTimeCounter - _prev[j].counter;
+                task.cpu = min<uint64_t>((uint64_t)ran * 1000 / elapsed, 1000);
+                if (strncmp(status.pcTaskName, "IDLE", 4) == 0)
+                {
+                    idle += task.cpu;
+                }
+                break;
+            }
+        }
+#endif
+        // 栈余量和CPU占用统计全部任务, 只保留前 MAX_TASKS 个任务的明细
+        if (i < MAX_TASKS)
+        {
+            _sampling[i] = task;
+        }
+    }
+#if configGENERATE_RUN_TIME_STATS
+    if (_prevTotal && elapsed > 0)
+    {
+        s.cpuLoad = idle < 1000 ? 1000 - idle : 0;
+    }
+#endif
+    RunTime *prev = _prev;
+    _prev = _current;
+    _current = prev;
+    _prevCount = n;
+    _prevTotal = total;
+    return min<size_t>(n, MAX_TASKS);
+#else
+    // 未启用任务跟踪时只记录当前任务
+    s.minStack = uxTaskGetStackHighWaterMark(NULL);
+    return 0;
+#endif
+}
+
+uint8_t SysProfiler::_checkFlags(const ResourceSample &s) const
+{
+    uint8_t flags = 0;
+    if (s.freeHeap < _minHeap)
+    {
+        flags |= PROFILE_HEAP_LOW;
+    }
+    if (s.minStack < _minStack)
+    {
+        flags |= PROFILE_STACK_LOW;
+    }
+    if (s.cpuLoad > _maxCpu)
+    {
+        flags |= PROFILE_CPU_HIGH;
+    }
+
+    // 最近几次采样中最大块从未增大, 且累计降幅超过门限
+    if (_count >= SHRINK_WINDOW - 1)
+    {
+        uint32_t newer = s.largestBlock;
+        bool shrinking = true;
+        uint32_t first = newer;
+        for (size_t i = 1; i < SHRINK_WINDOW && shrinking; i++)
+        {
+            const ResourceSample &older = _history[(_head + HISTORY_SIZE - i) % HISTORY_SIZE];
+            shrinking = older.largestBlock >= newer;
+            newer = older.largestBlock;
+            first = older.largestBlock;
+        }
+        if (shrinking && (uint64_t)(first - s.largestBlock) * 100 >= (uint64_t)first * SHRINK_PERCENT)
+        {
+            flags |= PROFILE_HEAP_SHRINKING;
+        }
+    }
+    return flags;
+}
+
+const ResourceSample *SysProfiler::_latest() const
+{
+    if (_count == 0)
+    {
+        return nullptr;
+    }
+    return &_history[(_head + HISTORY_SIZE - 1) % HISTORY_SIZE];
+}
+
+bool SysProfiler::latest(ResourceSample &out) const
+{
+    portENTER_CRITICAL(&_lock);
+    const ResourceSample *last = _latest();
+    if (last)
+    {
+        out = *last;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return last != nullptr;
+}
+
+size_t SysProfiler::history(ResourceSample *out, size_t max) const
+{
+    portENTER_CRITICAL(&_lock);
+    size_t n = min(max, _count);
+    size_t start = (_head + HISTORY_SIZE - n) % HISTORY_SIZE;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = _history[(start + i) % HISTORY_SIZE];
+    }
+    portEXIT_CRITICAL(&_lock);
+    return n;
+}
+
+size_t SysProfiler::tasks(TaskProfile *out, size_t max) const
+{
+    portENTER_CRITICAL(&_lock);
+    size_t n = min(max, _taskCount);
+    memcpy(out, _tasks, n * sizeof(TaskProfile));
+    portEXIT_CRITICAL(&_lock);
+    return n;
+}
+
+uint8_t SysProfiler::flags() const
+{
+    ResourceSample last;
+    return latest(last) ? last.flags : 0;
+}
+
+size_t SysProfiler::record(uint8_t *out, size_t max) const
+{
+    ResourceSample sample;
+    if (max < RECORD_SIZE || !latest(sample))
+    {
+        return 0;
+    }
+    const ResourceSample *s = &sample;
+
+    size_t len = 0;
+    auto put = [&](uint32_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++)
+        {
+            out[len++] = value >> (8 * i);
+        }
+    };
+    put('P', 1);
+    put(RECORD_VERSION, 1);
+    put(s->flags, 1);
+    put(s->fragmentation, 1);
+    put(s->time, 4);
+    put(s->freeHeap, 4);
+    put(s->minFreeHeap, 4);
+    put(s->largestBlock, 4);
+    put(s->cpuLoad, 2);
+    put(s->minStack, 2);
+    return len;
+}
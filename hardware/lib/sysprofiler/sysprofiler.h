@@ -0,0 +1,149 @@
+/*
+ * 系统资源采样
+ * 定期记录堆碎片、最小空闲堆、各任务栈余量和CPU占用, 检测资源持续恶化
+ * 采样在主循环中进行, 查询接口返回副本, 可在其他任务中调用
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// 单次资源采样
+struct ResourceSample
+{
+    uint32_t time;           // 采样时间(millis)
+    uint32_t freeHeap;       // 空闲堆(字节)
+    uint32_t minFreeHeap;    // 启动以来最小空闲堆(字节)
+    uint32_t largestBlock;   // 最大可分配块(字节)
+    uint16_t cpuLoad;        // 非空闲任务CPU占用(0.1%), 不支持时为0
+    uint16_t minStack;       // 各任务中最小的栈余量(字节)
+    uint8_t fragmentation;   // 堆碎片率(%)
+    uint8_t flags;           // 本次采样时的告警标志 PROFILE_*
+};
+
+// 单个任务的资源占用
+struct TaskProfile
+{
+    char name[16];
+    uint32_t stackFree;      // 栈余量历史最小值(字节)
+    uint16_t cpu;            // 上一个采样间隔内的CPU占用(0.1%)
+};
+
+// 告警标志
+#define PROFILE_HEAP_SHRINKING 0x01   // 最大可分配块持续减小
+#define PROFILE_HEAP_LOW       0x02   // 空闲堆低于门限
+#define PROFILE_STACK_LOW      0x04   // 有任务栈余量低于门限
+#define PROFILE_CPU_HIGH       0x08   // CPU占用高于门限
+
+class SysProfiler
+{
+public:
+    static const size_t HISTORY_SIZE = 32;
+    static const size_t MAX_TASKS = 32;     // tasks() 保留明细的最大任务数
+    static const size_t RECORD_SIZE = 24;
+
+    SysProfiler();
+    ~SysProfiler();
+
+    /**
+     * 设置采样间隔
+     * @param ms 采样间隔(毫秒)
+     */
+    void setInterval(uint32_t ms) { _interval = ms; }
+
+    /**
+     * 设置告警门限
+     * @param minHeap 空闲堆下限(字节)
+     * @param minStack 任务栈余量下限(字节)
+     * @param maxCpu CPU占用上限(0.1%)
+     */
+    void setThreshold(uint32_t minHeap, uint32_t minStack, uint16_t maxCpu);
+
+    /**
+     * 到达采样间隔时采样一次, 可在主循环中频繁调用
+     * @param force 忽略采样间隔
+     * @return 是否产生了新的采样
+     */
+    bool sample(bool force = false);
+
+    /**
+     * 复制最近一次采样
+     * @param out 输出采样
+     * @return 是否有采样
+     */
+    bool latest(ResourceSample &out) const;
+
+    /**
+     * 按时间顺序复制采样历史
+     * @param out 输出数组
+     * @param max 数组大小
+     * @return 复制的采样数
+     */
+    size_t history(ResourceSample *out, size_t max) const;
+
+    /**
+     * 复制最近一次采样时各任务的资源占用, 最多 MAX_TASKS 个
+     * @param out 输出数组
+     * @param max 数组大小
+     * @return 复制的任务数
+     */
+    size_t tasks(TaskProfile *out, size_t max) const;
+
+    /**
+     * 最近一次采样的告警标志
+     */
+    uint8_t flags() const;
+
+    /**
+     * 把最近一次采样编码为上传用的定长记录
+     * 格式: 'P', 版本, 标志, 碎片率, 时间, 空闲堆, 最小空闲堆, 最大块, CPU占用, 最小栈余量(小端)
+     * @param out 输出缓冲区
+     * @param max 缓冲区大小, 至少 RECORD_SIZE
+     * @return 记录长度, 没有采样时返回0
+     */
+    size_t record(uint8_t *out, size_t max) const;
+
+    /**
+     * 最近一次采样本身的耗时(微秒)
+     */
+    uint32_t overhead() const { return _overhead; }
+
+private:
+    // 上次采样时任务的累计运行时间, 用于计算区间占用
+    struct RunTime
+    {
+        TaskHandle_t handle;
+        uint32_t counter;
+    };
+
+    bool _reserve(size_t count);
+    size_t _sampleTasks(ResourceSample &s);
+    uint8_t _checkFlags(const ResourceSample &s) const;
+    const ResourceSample *_latest() const;
+
+    uint32_t _interval;
+    uint32_t _minHeap;
+    uint32_t _minStack;
+    uint16_t _maxCpu;
+    uint32_t _overhead;
+
+    ResourceSample _history[HISTORY_SIZE];
+    size_t _head;   // 下一次写入的位置
+    size_t _count;
+
+    // 按系统任务数分配, 只在采样任务中访问
+    TaskStatus_t *_status;
+    RunTime *_prev;
+    RunTime *_current;
+    size_t _capacity;
+
+    TaskProfile _sampling[MAX_TASKS];   // 采样过程中写入, 完成后复制到 _tasks
+    TaskProfile _tasks[MAX_TASKS];
+    size_t _taskCount;
+    size_t _prevCount;
+    uint32_t _prevTotal;
+
+    // 保护 _history/_head/_count/_tasks/_taskCount
+    mutable portMUX_TYPE _lock;
+};
@@ -0,0 +1,299 @@
+#include "uarttrace.h"
+
+UartTrace::UartTrace()
+    : _io(nullptr), _buf(nullptr), _size(0), _len(0), _lastUs(0),
+      _recording(false), _overflow(false), _rxPos(0), _rxLen(0)
+{
+    _lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void UartTrace::begin(Stream &io, uint8_t *buffer, size_t size)
+{
+    _io = &io;
+    _buf = buffer;
+    _size = size;
+    _len = 0;
+    _rxPos = 0;
+    _rxLen = 0;
+    _recording = false;
+    _overflow = false;
+}
+
+void UartTrace::start()
+{
+    portENTER_CRITICAL(&_lock);
+    _len = 0;
+    _overflow = false;
+    _lastUs = micros();
+    _recording = (_buf != nullptr && _size > 0);
+    portEXIT_CRITICAL(&_lock);
+}
+
+void UartTrace::stop()
+{
+    portENTER_CRITICAL(&_lock);
+    _recording = false;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void UartTrace::dump(Print &out)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    char line[65];
+    size_t n = 0;
+
+    // 记录只追加, 已写入的部分在导出期间不会改变
+    portENTER_CRITICAL(&_lock);
+    size_t len = _len;
+    portEXIT_CRITICAL(&_lock);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        line[n++] = hex[_buf[i] >> 4];
+        line[n++] = hex[_buf[i] & 0x0F];
+        if (n == 64 || i == len - 1)
+        {
+            line[n] = '\0';
+            out.println(line);
+            n = 0;
+        }
+    }
+}
+
+bool UartTrace::_putVarint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        if (_len >= _size)
+            return false;
+        _buf[_len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    if (_len >= _size)
+        return false;
+    _buf[_len++] = (uint8_t)value;
+    return true;
+}
+
+void UartTrace::_record(TraceDir dir, const uint8_t *data, size_t len)
+{
+    if (!_recording || len == 0)
+        return;
+
+    portENTER_CRITICAL(&_lock);
+    if (!_recording || _overflow)
+    {
+        portEXIT_CRITICAL(&_lock);
+        return;
+    }
+
+    uint32_t now = micros();
+    size_t start = _len;
+
+    if (!_putVarint(now - _lastUs) ||
+        !_putVarint((uint32_t)(len << 1) | (uint32_t)dir) ||
+        _size - _len < len)
+    {
+        // 不写入不完整的记录
+        _len = start;
+        _overflow = true;
+    }
+    else
+    {
+        memcpy(_buf + _len, data, len);
+        _len += len;
+        _lastUs = now;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+void UartTrace::_fill()
+{
+    if (_rxPos < _rxLen || !_io)
+        return;
+
+    int avail = _io->available();
+    if (avail <= 0)
+        return;
+
+    size_t n = min((size_t)avail, sizeof(_rx));
+    _rxLen = _io->readBytes(_rx, n);
+    _rxPos = 0;
+    _record(TraceDir::RX, _rx, _rxLen);
+}
+
+int UartTrace::available()
+{
+    if (!_io)
+        return 0;
+    return (int)(_rxLen - _rxPos) + _io->available();
+}
+
+int UartTrace::read()
+{
+    _fill();
+    if (_rxPos >= _rxLen)
+        return -1;
+    return _rx[_rxPos++];
+}
+
+int UartTrace::peek()
+{
+    _fill();
+    if (_rxPos >= _rxLen)
+        return -1;
+    return _rx[_rxPos];
+}
+
+size_t UartTrace::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t UartTrace::write(const uint8_t *data, size_t len)
+{
+    if (!_io)
+        return 0;
+    size_t written = _io->write(data, len);
+    _record(TraceDir::TX, data, written);
+    return written;
+}
+
+void UartTrace::flush()
+{
+    if (_io)
+        _io->flush();
+}
+
+UartReplay::UartReplay()
+    : _trace(nullptr), _len(0), _pos(0), _realtime(true), _anchorUs(0),
+      _hasCur(false), _curDelta(0), _curDir(TraceDir::RX), _curData(nullptr),
+      _curLen(0), _curOff(0), _mismatches(0), _unexpected(0), _rxBytes(0)
+{
+}
+
+void UartReplay::begin(const uint8_t *trace, size_t len, bool realtime)
+{
+    _trace = trace;
+    _len = len;
+    _pos = 0;
+    _realtime = realtime;
+    _anchorUs = micros();
+    _hasCur = false;
+    _mismatches = 0;
+    _unexpected = 0;
+    _rxBytes = 0;
+}
+
+bool UartReplay::finished()
+{
+    _advance();
+    return !_hasCur && _pos >= _len;
+}
+
+bool UartReplay::_getVarint(uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 32 && _pos < _len; shift += 7)
+    {
+        uint8_t b = _trace[_pos++];
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool UartReplay::_parseHeader()
+{
+    uint32_t delta, header;
+    if (!_getVarint(delta) || !_getVarint(header))
+    {
+        _pos = _len;
+        return false;
+    }
+
+    size_t len = header >> 1;
+    if (_len - _pos < len)
+    {
+        // 记录被截断
+        _pos = _len;
+        return false;
+    }
+
+    _curDelta = delta;
+    _curDir = (header & 1) ? TraceDir::TX : TraceDir::RX;
+    _curData = _trace + _pos;
+    _curLen = len;
+    _curOff = 0;
+    _pos += len;
+    _hasCur = true;
+    return true;
+}
+
+void UartReplay::_advance()
+{
+    while (true)
+    {
+        if (_hasCur && _curOff >= _curLen)
+            _hasCur = false;
+        if (!_hasCur && (_pos >= _len || !_parseHeader()))
+            return;
+
+        // 等待原始时间间隔到达后才生效
+        if (_curDelta > 0)
+        {
+            if (_realtime && micros() - _anchorUs < _curDelta)
+                return;
+            _curDelta = 0;
+            _anchorUs = micros();
+        }
+
+        if (_curOff < _curLen)
+            return;
+    }
+}
+
+int UartReplay::available()
+{
+    _advance();
+    if (!_hasCur || _curDir != TraceDir::RX || _curDelta > 0)
+        return 0;
+    return (int)(_curLen - _curOff);
+}
+
+int UartReplay::read()
+{
+    if (available() <= 0)
+        return -1;
+    _rxBytes++;
+    return _curData[_curOff++];
+}
+
+int UartReplay::peek()
+{
+    if (available() <= 0)
+        return -1;
+    return _curData[_curOff];
+}
+
+size_t UartReplay::write(uint8_t c)
+{
+    _advance();
+    if (_hasCur && _curDir == TraceDir::TX)
+    {
+        // 调制解调器比记录更早发送时, 直接让该条记录生效
+        if (_curDelta > 0)
+        {
+            _curDelta = 0;
+            _anchorUs = micros();
+        }
+        if (_curData[_curOff++] != c)
+            _mismatches++;
+    }
+    else
+    {
+        _unexpected++;
+    }
+    return 1;
+}
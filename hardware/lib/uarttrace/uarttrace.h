@@ -0,0 +1,146 @@
+/*
+ * 串口收发记录与回放
+ *
+ * 记录格式(紧凑二进制, 按记录顺序排列):
+ *   时间增量(varint, 距上一条记录的微秒数)
+ *   头部(varint, 数据长度 << 1 | 方向)
+ *   数据(长度字节)
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// 数据方向
+enum class TraceDir : uint8_t
+{
+    RX = 0, // 调制解调器 -> ESP32
+    TX = 1  // ESP32 -> 调制解调器
+};
+
+/**
+ * 串口记录器
+ * 包装实际串口, 透传读写的同时把双向数据记录到缓冲区
+ * PPP连接期间发送在lwIP线程、接收在工作任务中进行, 记录操作由临界区保护
+ */
+class UartTrace : public Stream
+{
+public:
+    UartTrace();
+
+    /**
+     * 绑定实际串口和记录缓冲区
+     * @param io 被包装的串口
+     * @param buffer 记录缓冲区
+     * @param size 缓冲区大小
+     */
+    void begin(Stream &io, uint8_t *buffer, size_t size);
+
+    /**
+     * 开始记录(清空已有记录)
+     */
+    void start();
+
+    /**
+     * 停止记录, 之后的读写仅透传
+     */
+    void stop();
+
+    bool isRecording() const { return _recording; }
+    bool overflowed() const { return _overflow; }
+    Stream *source() const { return _io; }
+    const uint8_t *data() const { return _buf; }
+    size_t length() const { return _len; }
+
+    /**
+     * 以十六进制文本导出记录, 每行32字节
+     * @param out 输出目标
+     */
+    void dump(Print &out);
+
+    // Stream 接口
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    void flush() override;
+
+private:
+    void _fill();
+    void _record(TraceDir dir, const uint8_t *data, size_t len);
+    bool _putVarint(uint32_t value);
+
+    Stream *_io;
+    uint8_t *_buf;     // 记录缓冲区
+    size_t _size;
+    size_t _len;       // 已记录字节数
+    uint32_t _lastUs;  // 上一条记录的时间
+    bool _recording;
+    bool _overflow;    // 缓冲区已满, 后续记录被丢弃
+    portMUX_TYPE _lock;
+
+    // 批量读取的接收数据, 一次读取只产生一条记录
+    uint8_t _rx[64];
+    size_t _rxPos;
+    size_t _rxLen;
+};
+
+/**
+ * 串口回放器
+ * 把记录中的接收数据按原始时序(或尽快)交给调制解调器,
+ * 并把调制解调器的发送数据与记录对比
+ */
+class UartReplay : public Stream
+{
+public:
+    UartReplay();
+
+    /**
+     * 加载记录
+     * @param trace 记录数据
+     * @param len 记录长度
+     * @param realtime true: 按原始时间间隔回放, false: 尽快回放
+     */
+    void begin(const uint8_t *trace, size_t len, bool realtime = true);
+
+    /**
+     * 记录是否已全部回放
+     */
+    bool finished();
+
+    uint32_t mismatches() const { return _mismatches; }   // 发送内容与记录不一致的字节数
+    uint32_t unexpected() const { return _unexpected; }   // 记录之外的发送字节数
+    uint32_t rxBytes() const { return _rxBytes; }         // 已回放的接收字节数
+
+    // Stream 接口
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t len) override { return Print::write(data, len); }
+    void flush() override {}
+
+private:
+    bool _parseHeader();
+    void _advance();
+    bool _getVarint(uint32_t &value);
+
+    const uint8_t *_trace;
+    size_t _len;
+    size_t _pos;        // 下一条记录的位置
+    bool _realtime;
+    uint32_t _anchorUs; // 上一条记录回放的时间
+
+    // 当前记录
+    bool _hasCur;
+    uint32_t _curDelta;
+    TraceDir _curDir;
+    const uint8_t *_curData;
+    size_t _curLen;
+    size_t _curOff;     // 已回放/已对比的字节数
+
+    uint32_t _mismatches;
+    uint32_t _unexpected;
+    uint32_t _rxBytes;
+};
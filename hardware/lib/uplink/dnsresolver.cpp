@@ -0,0 +1,75 @@
+#include "dnsresolver.h"
+#include "logger.h"
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+
+DnsResolver::DnsResolver() : _idle(nullptr), _pending(nullptr), _done(false), _ok(false), _cached(0), _queried(0)
+{
+    _addr.addr = 0;
+}
+
+// 在协议栈线程中调用
+void DnsResolver::_found(const char *name, const ip_addr_t *ipaddr, void *arg)
+{
+    DnsResolver *self = (DnsResolver *)arg;
+    if (!self->_pending || strcmp(name, self->_pending) != 0)
+    {
+        return;
+    }
+    self->_ok = ipaddr != nullptr && IP_IS_V4(ipaddr);
+    if (self->_ok)
+    {
+        ip4_addr_copy(self->_addr, *ip_2_ip4(ipaddr));
+    }
+    self->_done = true;
+}
+
+bool DnsResolver::resolve(const char *host, ip4_addr_t &addr, uint32_t timeout)
+{
+    ip_addr_t result;
+    _pending = host;
+    _done = false;
+
+    LOCK_TCPIP_CORE();
+    err_t err = dns_gethostbyname_addrtype(host, &result, _found, this, LWIP_DNS_ADDRTYPE_IPV4);
+    UNLOCK_TCPIP_CORE();
+
+    // IP地址字符串或缓存命中
+    if (err == ERR_OK)
+    {
+        _pending = nullptr;
+        _cached++;
+        ip4_addr_copy(addr, *ip_2_ip4(&result));
+        return true;
+    }
+    if (err != ERR_INPROGRESS)
+    {
+        _pending = nullptr;
+        LOG_E("DNS查询失败: " + String(host));
+        return false;
+    }
+
+    _queried++;
+    unsigned long start = millis();
+    while (!_done && millis() - start < timeout)
+    {
+        if (_idle)
+        {
+            _idle();
+        }
+        delay(1);
+    }
+
+    // 清除后协议栈线程不再写入结果
+    LOCK_TCPIP_CORE();
+    _pending = nullptr;
+    UNLOCK_TCPIP_CORE();
+
+    if (!_done || !_ok)
+    {
+        LOG_E("DNS查询" + String(_done ? "失败" : "超时") + ": " + String(host));
+        return false;
+    }
+    addr = _addr;
+    return true;
+}
@@ -0,0 +1,45 @@
+/*
+ * DNS解析
+ * 使用lwIP的DNS客户端, 结果由协议栈按应答TTL缓存; 等待应答时不阻塞PPP输入
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <lwip/ip_addr.h>
+
+class DnsResolver
+{
+public:
+    typedef void (*IdleHandler)();
+
+    DnsResolver();
+
+    /**
+     * 设置等待应答时调用的函数(如处理PPP输入)
+     * @param idle 空闲处理函数
+     */
+    void setIdleHandler(IdleHandler idle) { _idle = idle; }
+
+    /**
+     * 解析域名, 协议栈缓存未过期时直接返回
+     * @param host 域名或IP地址字符串
+     * @param addr 输出地址
+     * @param timeout 查询超时(毫秒)
+     * @return 是否成功
+     */
+    bool resolve(const char *host, ip4_addr_t &addr, uint32_t timeout = 10000);
+
+    uint32_t cached() const { return _cached; }    // 由协议栈缓存或IP地址字符串直接得到结果的次数
+    uint32_t queried() const { return _queried; }  // 向DNS服务器发出查询的次数
+
+private:
+    static void _found(const char *name, const ip_addr_t *ipaddr, void *arg);
+
+    IdleHandler _idle;
+    const char *_pending;       // 正在等待应答的域名, 用于忽略超时后才到达的旧应答
+    volatile bool _done;
+    bool _ok;
+    ip4_addr_t _addr;
+    uint32_t _cached;
+    uint32_t _queried;
+};
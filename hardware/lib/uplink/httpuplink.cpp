@@ -0,0 +1,236 @@
+#include "httpuplink.h"
+#include "logger.h"
+
+HttpUplink::HttpUplink(const char *host, uint16_t port, const char *path)
+    : _host(host), _port(port), _path(path), _timeout(30000), _rxPos(0), _rxLen(0)
+{
+}
+
+void HttpUplink::setServer(const char *host, uint16_t port, const char *path)
+{
+    close();
+    _host = host;
+    _port = port;
+    _path = path;
+}
+
+bool HttpUplink::send(const uint8_t *data, size_t len)
+{
+    unsigned long start = millis();
+
+    char header[256];
+    int headerLen = snprintf(header, sizeof(header),
+                             "POST %s HTTP/1.1\r\nHost: %s\r\n"
+                             "Content-Type: application/octet-stream\r\n"
+                             "Content-Length: %u\r\nConnection: keep-alive\r\n\r\n",
+                             _path, _host, (unsigned)len);
+
+    bool ok = false;
+    for (int attempt = 0; attempt < 2 && !ok; attempt++)
+    {
+        bool reused = connected();
+        if (!reused && !_connect())
+        {
+            break;
+        }
+
+        int status = 0;
+        if (_write((const uint8_t *)header, headerLen) && _write(data, len) && _readResponse(status))
+        {
+            ok = status >= 200 && status < 300;
+            if (!ok)
+            {
+                LOG_E("服务器返回: " + String(status));
+            }
+            break;
+        }
+
+        // 服务器可能已关闭空闲连接, 只对复用的连接重连重试一次
+        close();
+        if (!reused)
+        {
+            break;
+        }
+        LOG_D("长连接已失效, 重新连接");
+    }
+
+    _stats.lastLatencyMs = millis() - start;
+    if (ok)
+    {
+        _stats.uploads++;
+    }
+    else
+    {
+        _stats.failures++;
+    }
+    return ok;
+}
+
+int HttpUplink::_fill()
+{
+    unsigned long start = millis();
+    while (true)
+    {
+        int ret = _read(_rx, sizeof(_rx));
+        if (ret > 0)
+        {
+            _rxPos = 0;
+            _rxLen = ret;
+            _stats.bytesReceived += ret;
+            return ret;
+        }
+        if (ret < 0 || millis() - start >= _timeout)
+        {
+            return -1;
+        }
+        _yield();
+    }
+}
+
+bool HttpUplink::_readLine(String &line)
+{
+    line = "";
+    while (true)
+    {
+        if (_rxPos >= _rxLen && _fill() <= 0)
+        {
+            return false;
+        }
+        char c = _rx[_rxPos++];
+        if (c == '\n')
+        {
+            line.trim();
+            return true;
+        }
+        line += c;
+    }
+}
+
+bool HttpUplink::_skip(size_t len)
+{
+    while (len > 0)
+    {
+        if (_rxPos >= _rxLen && _fill() <= 0)
+        {
+            return false;
+        }
+        size_t n = min(len, _rxLen - _rxPos);
+        _rxPos += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool HttpUplink::_skipChunked()
+{
+    String line;
+    while (true)
+    {
+        // 块大小(十六进制), 之后可能有扩展参数
+        if (!_readLine(line))
+        {
+            return false;
+        }
+        char *end;
+        size_t size = strtoul(line.c_str(), &end, 16);
+        if (end == line.c_str())
+        {
+            return false;
+        }
+        if (size == 0)
+        {
+            break;
+        }
+        // 块数据及其后的CRLF
+        if (!_skip(size) || !_readLine(line))
+        {
+            return false;
+        }
+    }
+
+    // 尾部字段, 以空行结束
+    do
+    {
+        if (!_readLine(line))
+        {
+            return false;
+        }
+    } while (line.length() > 0);
+    return true;
+}
+
+bool HttpUplink::_readResponse(int &status)
+{
+    String line;
+    size_t contentLength;
+    bool hasLength, chunked, keepAlive;
+    do
+    {
+        if (!_readLine(line) || sscanf(line.c_str(), "HTTP/%*s %d", &status) != 1)
+        {
+            return false;
+        }
+
+        contentLength = 0;
+        hasLength = chunked = false;
+        keepAlive = true;
+        while (true)
+        {
+            if (!_readLine(line))
+            {
+                return false;
+            }
+            if (line.length() == 0)
+            {
+                break;
+            }
+            line.toLowerCase();
+            if (line.startsWith("content-length:"))
+            {
+                contentLength = line.substring(15).toInt();
+                hasLength = true;
+            }
+            else if (line.startsWith("transfer-encoding:") && line.indexOf("chunked") > 0)
+            {
+                chunked = true;
+            }
+            else if (line.startsWith("connection:") && line.indexOf("close") > 0)
+            {
+                keepAlive = false;
+            }
+        }
+        // 1xx 中间响应(如 100 Continue)没有响应体, 之后才是最终响应
+    } while (status >= 100 && status < 200);
+
+    // 丢弃响应体, 保持连接可以继续使用
+    if (status == 204 || status == 304)
+    {
+        // 没有响应体
+    }
+    else if (chunked)
+    {
+        // 分块编码优先于 Content-Length
+        if (!_skipChunked())
+        {
+            return false;
+        }
+    }
+    else if (hasLength)
+    {
+        if (!_skip(contentLength))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // 响应体以关闭连接结束, 连接不能继续使用
+        keepAlive = false;
+    }
+
+    if (!keepAlive)
+    {
+        close();
+    }
+    return true;
+}
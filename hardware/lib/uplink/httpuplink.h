@@ -0,0 +1,83 @@
+/*
+ * 基于HTTP POST的上行
+ * 实现请求/响应和keep-alive, 跳过1xx中间响应并按 Content-Length 或分块编码读完响应体,
+ * 传输方式(PPP上的TLS、模块内置socket)由子类提供
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "uplink.h"
+
+class HttpUplink : public Uplink
+{
+public:
+    /**
+     * @param host 服务器域名
+     * @param port 服务器端口
+     * @param path 上传路径(HTTP POST)
+     */
+    HttpUplink(const char *host, uint16_t port, const char *path);
+
+    /**
+     * 更换服务器, 关闭现有连接
+     * @param host 服务器域名
+     * @param port 服务器端口
+     * @param path 上传路径
+     */
+    virtual void setServer(const char *host, uint16_t port, const char *path);
+
+    /**
+     * 设置网络操作超时
+     * @param ms 超时时间(毫秒)
+     */
+    void setTimeout(uint32_t ms) { _timeout = ms; }
+
+    /**
+     * 上传一条数据, 复用的连接失效时重新连接并重试一次
+     */
+    bool send(const uint8_t *data, size_t len) override;
+
+    /**
+     * 是否保持着已建立的连接
+     */
+    virtual bool connected() const = 0;
+
+protected:
+    /**
+     * 建立连接, 成功时更新连接统计
+     */
+    virtual bool _connect() = 0;
+
+    /**
+     * 发送全部数据, 等待期间调用 _yield()
+     */
+    virtual bool _write(const uint8_t *data, size_t len) = 0;
+
+    /**
+     * 读取已收到的数据, 不等待
+     * @return 读取的字节数, 暂无数据返回0, 出错或连接关闭返回-1
+     */
+    virtual int _read(uint8_t *buffer, size_t max) = 0;
+
+    /**
+     * 丢弃接收缓冲区, 关闭连接时调用
+     */
+    void _resetRx() { _rxPos = _rxLen = 0; }
+
+    const char *_host;
+    uint16_t _port;
+    const char *_path;
+    uint32_t _timeout;
+
+private:
+    bool _readLine(String &line);
+    bool _readResponse(int &status);
+    bool _skip(size_t len);
+    bool _skipChunked();
+    int _fill();
+
+    // 响应接收缓冲区
+    uint8_t _rx[256];
+    size_t _rxPos;
+    size_t _rxLen;
+};
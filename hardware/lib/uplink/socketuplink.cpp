@@ -0,0 +1,61 @@
+#include "socketuplink.h"
+#include "logger.h"
+
+SocketUplink::SocketUplink(Modem &modem, const char *host, uint16_t port, const char *path)
+    : HttpUplink(host, port, path), _modem(modem), _apn(""), _open(false)
+{
+}
+
+SocketUplink::~SocketUplink()
+{
+    close();
+}
+
+void SocketUplink::close()
+{
+    if (_open)
+    {
+        _modem.socketClose(SOCKET_ID);
+        _open = false;
+    }
+    _resetRx();
+}
+
+bool SocketUplink::_connect()
+{
+    unsigned long start = millis();
+    if (!_modem.socketAttach(_apn) ||
+        !_modem.socketOpen(SOCKET_ID, MODEM_SOCKET_TCP, _host, _port, _timeout))
+    {
+        LOG_E(String("连接服务器失败: ") + _host);
+        return false;
+    }
+
+    _open = true;
+    _stats.connects++;
+    _stats.lastConnectMs = millis() - start;
+    _resetRx();
+    LOG_D("TCP连接建立, 耗时 " + String(_stats.lastConnectMs) + " ms");
+    return true;
+}
+
+bool SocketUplink::_write(const uint8_t *data, size_t len)
+{
+    if (!_modem.socketSend(SOCKET_ID, data, len))
+    {
+        return false;
+    }
+    _stats.bytesSent += len;
+    return true;
+}
+
+int SocketUplink::_read(uint8_t *buffer, size_t max)
+{
+    int ret = _modem.socketRead(SOCKET_ID, buffer, max);
+    if (ret == 0 && !_modem.socketReadable(SOCKET_ID))
+    {
+        // 没有数据且没有新数据上报时降低查询频率
+        delay(50);
+    }
+    return ret;
+}
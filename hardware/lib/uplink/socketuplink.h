@@ -0,0 +1,43 @@
+/*
+ * 通过模块内置TCP协议栈上传
+ * 不进行PPP拨号和LCP/IPCP协商, 适合发送少量数据; 连接为明文TCP, 服务器需提供HTTP端口
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "httpuplink.h"
+#include "modem.h"
+
+class SocketUplink : public HttpUplink
+{
+public:
+    /**
+     * @param modem 调制解调器
+     * @param host 服务器域名
+     * @param port 服务器端口
+     * @param path 上传路径(HTTP POST)
+     */
+    SocketUplink(Modem &modem, const char *host, uint16_t port, const char *path);
+    ~SocketUplink();
+
+    /**
+     * 设置激活PDP上下文使用的APN, 应与PPP拨号使用的APN相同
+     * @param apn APN名称, 默认为空(由网络分配)
+     */
+    void setAPN(const char *apn) { _apn = apn; }
+
+    void close() override;
+    bool connected() const override { return _open; }
+
+protected:
+    bool _connect() override;
+    bool _write(const uint8_t *data, size_t len) override;
+    int _read(uint8_t *buffer, size_t max) override;
+
+private:
+    static const uint8_t SOCKET_ID = 0;
+
+    Modem &_modem;
+    const char *_apn;
+    bool _open;
+};
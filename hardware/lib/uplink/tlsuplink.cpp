@@ -0,0 +1,178 @@
+#include "tlsuplink.h"
+#include "logger.h"
+#include <lwip/netif.h>
+#include <lwip/sockets.h>
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include <esp_crt_bundle.h>
+#endif
+
+TlsUplink::TlsUplink(const char *host, uint16_t port, const char *path)
+    : HttpUplink(host, port, path), _caCert(nullptr), _netif(nullptr), _tls(nullptr)
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+      , _session(nullptr)
+#endif
+{
+}
+
+TlsUplink::~TlsUplink()
+{
+    close();
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (_session)
+    {
+        esp_tls_free_client_session(_session);
+    }
+#endif
+}
+
+void TlsUplink::setServer(const char *host, uint16_t port, const char *path)
+{
+    HttpUplink::setServer(host, port, path);
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (_session)
+    {
+        esp_tls_free_client_session(_session);
+        _session = nullptr;
+    }
+#endif
+}
+
+void TlsUplink::setNetif(struct netif *netif)
+{
+    if (netif != _netif)
+    {
+        close();
+        _netif = netif;
+    }
+}
+
+void TlsUplink::close()
+{
+    if (_tls)
+    {
+        esp_tls_conn_destroy(_tls);
+        _tls = nullptr;
+    }
+    _resetRx();
+}
+
+bool TlsUplink::_connect()
+{
+    unsigned long start = millis();
+    _dns.setIdleHandler(_idle);
+
+    ip4_addr_t addr;
+    if (!_dns.resolve(_host, addr, _timeout))
+    {
+        return false;
+    }
+    char ip[16];
+    ip4addr_ntoa_r(&addr, ip, sizeof(ip));
+
+    // 按IP连接, 证书校验和SNI仍使用域名
+    esp_tls_cfg_t cfg = {};
+    if (_caCert)
+    {
+        cfg.cacert_pem_buf = (const unsigned char *)_caCert;
+        cfg.cacert_pem_bytes = strlen(_caCert) + 1;
+    }
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+    else
+    {
+        cfg.crt_bundle_attach = esp_crt_bundle_attach;
+    }
+#endif
+    cfg.common_name = _host;
+    cfg.non_block = true;
+    cfg.timeout_ms = _timeout;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    cfg.client_session = _session;
+#endif
+    // 绑定到指定链路, 不经过默认路由
+    struct ifreq ifr = {};
+    if (_netif)
+    {
+        netif_index_to_name(netif_get_index(_netif), ifr.ifr_name);
+        cfg.if_name = &ifr;
+    }
+
+    _tls = esp_tls_init();
+    if (!_tls)
+    {
+        return false;
+    }
+
+    int ret;
+    while ((ret = esp_tls_conn_new_async(ip, strlen(ip), _port, &cfg, _tls)) == 0)
+    {
+        if (millis() - start > _timeout)
+        {
+            break;
+        }
+        _yield();
+    }
+
+    if (ret != 1)
+    {
+        LOG_E(String("连接服务器失败: ") + _host);
+        esp_tls_conn_destroy(_tls);
+        _tls = nullptr;
+        return false;
+    }
+
+    _stats.connects++;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t *session = esp_tls_get_client_session(_tls);
+    if (_session)
+    {
+        // 服务器可能拒绝复用而进行完整握手, 复用时主密钥与提供的会话相同
+        if (session && memcmp(session->saved_session.MBEDTLS_PRIVATE(master),
+                              _session->saved_session.MBEDTLS_PRIVATE(master),
+                              sizeof(_session->saved_session.MBEDTLS_PRIVATE(master))) == 0)
+        {
+            _stats.resumed++;
+        }
+        esp_tls_free_client_session(_session);
+    }
+    _session = session;
+#endif
+    _stats.lastConnectMs = millis() - start;
+    _resetRx();
+    LOG_D("TLS连接建立, 耗时 " + String(_stats.lastConnectMs) + " ms");
+    return true;
+}
+
+bool TlsUplink::_write(const uint8_t *data, size_t len)
+{
+    unsigned long start = millis();
+    size_t written = 0;
+    while (written < len)
+    {
+        ssize_t ret = esp_tls_conn_write(_tls, data + written, len - written);
+        if (ret > 0)
+        {
+            written += ret;
+            _stats.bytesSent += ret;
+        }
+        else if ((ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE) &&
+                 millis() - start < _timeout)
+        {
+            _yield();
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int TlsUplink::_read(uint8_t *buffer, size_t max)
+{
+    ssize_t ret = esp_tls_conn_read(_tls, buffer, max);
+    if (ret > 0)
+    {
+        return ret;
+    }
+    return (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_WANT_WRITE) ? 0 : -1;
+}
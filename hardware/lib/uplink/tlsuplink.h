@@ -0,0 +1,59 @@
+/*
+ * PPP链路上的HTTPS长连接上行
+ * DNS结果由协议栈缓存, 在多次上传之间保持同一个TLS连接(HTTP keep-alive),
+ * 重连时使用TLS会话恢复跳过完整握手
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <esp_tls.h>
+#include "httpuplink.h"
+#include "dnsresolver.h"
+
+class TlsUplink : public HttpUplink
+{
+public:
+    /**
+     * @param host 服务器域名
+     * @param port 服务器端口
+     * @param path 上传路径(HTTP POST)
+     */
+    TlsUplink(const char *host, uint16_t port, const char *path);
+    ~TlsUplink();
+
+    /**
+     * 更换服务器, 关闭现有连接并丢弃会话
+     */
+    void setServer(const char *host, uint16_t port, const char *path) override;
+
+    /**
+     * 设置服务器CA证书
+     * @param pem PEM格式证书, 需在连接期间保持有效
+     */
+    void setCACert(const char *pem) { _caCert = pem; }
+
+    /**
+     * 把连接绑定到指定网络接口, 接口改变时关闭现有连接
+     * @param netif 网络接口, nullptr 表示按默认路由
+     */
+    void setNetif(struct netif *netif);
+
+    void close() override;
+    bool connected() const override { return _tls != nullptr; }
+
+    DnsResolver &dns() { return _dns; }
+
+protected:
+    bool _connect() override;
+    bool _write(const uint8_t *data, size_t len) override;
+    int _read(uint8_t *buffer, size_t max) override;
+
+private:
+    const char *_caCert;
+    struct netif *_netif;  // 绑定的网络接口
+    esp_tls_t *_tls;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t *_session;  // 上次握手得到的会话
+#endif
+    DnsResolver _dns;
+};
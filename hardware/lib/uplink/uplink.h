@@ -0,0 +1,62 @@
+/*
+ * 上行传输接口
+ * 不同传输方式(PPP上的TLS长连接、模块内置socket等)实现同一接口, 由上层按需选择
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// 上行统计
+struct UplinkStats
+{
+    uint32_t uploads;        // 成功上传次数
+    uint32_t failures;       // 失败次数
+    uint32_t connects;       // 建立连接次数
+    uint32_t resumed;        // 使用会话恢复的连接次数
+    uint32_t bytesSent;      // 应用层发送字节数
+    uint32_t bytesReceived;  // 应用层接收字节数
+    uint32_t lastConnectMs;  // 最近一次建立连接耗时
+    uint32_t lastLatencyMs;  // 最近一次上传耗时(含建立连接)
+};
+
+class Uplink
+{
+public:
+    typedef void (*IdleHandler)();
+
+    virtual ~Uplink() {}
+
+    /**
+     * 上传一条数据并等待服务器确认
+     * @param data 数据
+     * @param len 长度
+     * @return 服务器是否确认收到
+     */
+    virtual bool send(const uint8_t *data, size_t len) = 0;
+
+    /**
+     * 关闭连接
+     */
+    virtual void close() = 0;
+
+    /**
+     * 设置等待网络时调用的函数(如处理PPP输入)
+     * @param idle 空闲处理函数
+     */
+    void setIdleHandler(IdleHandler idle) { _idle = idle; }
+
+    const UplinkStats &stats() const { return _stats; }
+
+protected:
+    void _yield()
+    {
+        if (_idle)
+        {
+            _idle();
+        }
+        delay(1);
+    }
+
+    IdleHandler _idle = nullptr;
+    UplinkStats _stats = {};
+};
@@ -2,9 +2,111 @@
 #include <modem.h>
 #include <PPP.h>
 #include "logger.h"
+#include "signalmonitor.h"
+#include <LittleFS.h>
+#include "storequeue.h"
+#include "modemworker.h"
+#include "console.h"
+#include "serialbridge.h"
+#include "otaclient.h"
+#include "tlsuplink.h"
+#include "socketuplink.h"
+#include "sysprofiler.h"
+#include "depthcodec.h"
+#include "reportpolicy.h"
+#include "smsalarm.h"
+#include "pppcapture.h"
+#include "linkmanager.h"
 
 HardwareSerial modemSerial(1);
 
+// 调制解调器默认波特率
+#define MODEM_BAUD 115200
+
+SignalMonitor signalMonitor(modem);
+StoreQueue storeQueue(LittleFS);
+ModemWorker worker;
+Console console;
+SerialBridge bridge(Serial, modemSerial);
+OtaClient ota;
+SysProfiler profiler;
+ReportPolicy reportPolicy;
+DepthEncoder depthEncoder;
+SmsAlarm smsAlarm(modem);
+
+// 告警门限: 液位上限(0.1毫米), 下降速率(0.1毫米/分钟)
+#define ALARM_HIGH_LEVEL 18000
+#define ALARM_DROP_RATE 500
+
+// 告警代码
+#define ALARM_OVERFLOW 1
+#define ALARM_RAPID_DROP 2
+#define ALARM_TEST 0xFF
+
+// 正在编码的液位数据块, 发送时写入队列
+static uint8_t depthBlock[256];
+
+// 下一次定时采样液位的时间(millis), 由上报策略给出的间隔决定
+static uint32_t nextDepthSample = 0;
+
+// 拨号和模块内置协议栈使用的APN(中国移动)
+static const char *modemApn = "CMNET";
+
+// 已提交拨号任务, 等待执行
+static bool dialQueued = false;
+
+// 上行服务器, 由upload命令设置
+static char uplinkHost[64];
+static char uplinkPath[128];
+TlsUplink uplink(uplinkHost, 443, uplinkPath);
+
+#ifdef DUAL_MODEM
+// 第二个调制解调器(UART2), 两路PPP同时在线, 由链路管理切换默认路由并分配上传
+#define MODEM2_RX 26
+#define MODEM2_TX 27
+HardwareSerial modem2Serial(2);
+Modem modem2("MODEM2");
+LinkManager links(modem, modem2);
+// 每条链路各保持一个TLS长连接, uplink 使用主链路, uplink2 使用第二条链路
+TlsUplink uplink2(uplinkHost, 443, uplinkPath);
+#endif
+
+// 一次上传的最大数据量, 多条记录合并为一个请求
+#define UPLOAD_BATCH_SIZE 4096
+
+// PPP未连接时通过模块内置协议栈发送的单次最大数据量
+// 该方式为明文HTTP, 只在upload命令中显式指定plaintext时使用
+#define SOCKET_MAX_PAYLOAD 512
+static bool socketPlaintext = false;
+SocketUplink socketUplink(modem, uplinkHost, 80, uplinkPath);
+
+// 队列中有数据因信号较差推迟发送, 由工作任务空闲时重试
+static bool uploadWaiting = false;
+static uint32_t uploadWaitingSince;
+
+// 主循环两次迭代之间的最大间隔(微秒), 只在主循环中读写
+static uint32_t loopMaxGap = 0;
+
+// 主循环任务, 在setup()中获取
+static TaskHandle_t loopTask = nullptr;
+
+// 队列状态快照, 由工作任务空闲时更新, 查询命令在主循环中读取
+struct QueueStatus {
+    bool empty;
+    uint32_t dropped;
+    bool waiting;
+    uint32_t waitingSince;
+};
+static QueueStatus queueStatus = {true, 0, false, 0};
+static portMUX_TYPE statusLock = portMUX_INITIALIZER_UNLOCKED;
+
+// 串口记录缓冲区
+static uint8_t traceBuffer[16 * 1024];
+
+// PPP抓包缓冲区
+static uint8_t captureBuffer[16 * 1024];
+PppCapture capture;
+
 void testModemBasicFunctions() {
     Serial.println("\n========= 基础功能测试 =========");
     
@@ -22,9 +124,7 @@ void testModemBasicFunctions() {
 
     // 获取模块信息
     Serial.println("\n3. 获取模块信息:");
-    response = modem.sendCommand("ATI");
-    Serial.println("发送: ATI");
-    Serial.println("响应: " + response);
+    Serial.println("模块信息: " + modem.getModuleInfo());
 
     // 获取IMEI号
     Serial.println("\n4. 获取IMEI号:");
@@ -36,7 +136,7 @@ void testPPPconnect() {
     Serial.println("\n========= PPP拨号测试 =========");
     
     Serial.println("\n1. 开始拨号...");
-    if (modem.connect("CMNET", "", "")) {  // 修改这里使用中国移动APN
+    if (modem.connect(modemApn, "", "")) {
         Serial.println("拨号成功！");
         
         // 等待5秒
@@ -86,7 +186,7 @@ void testModemMode() {
 
     // 尝试PPP拨号
     Serial.println("\n2. 尝试PPP拨号:");
-    if (modem.connect("CMNET", "", "")) {
+    if (modem.connect(modemApn, "", "")) {
         Serial.println("PPP拨号成功");
         delay(2000); // 等待PPP协商完成
         
@@ -102,27 +202,543 @@ void testModemMode() {
     }
 }
 
-void processSerialCommand() {
-    if (Serial.available()) {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
-        
-        // 特殊命令处理
-        if (command == "test") {
-            testModemBasicFunctions();
-            return;
-        } else if (command == "connect") {
-            testPPPconnect();
+void cmdTest(const String &args) {
+    testModemBasicFunctions();
+}
+
+void cmdConnect(const String &args) {
+    testPPPconnect();
+}
+
+void cmdCsq(const String &args) {
+    SignalSample samples[8];
+    size_t n = signalMonitor.history(samples, 8);
+    for (size_t i = 0; i < n; i++) {
+        Serial.printf("%lu ms: RSSI %d dBm, BER %u, RSRP %d dBm, RSRQ %d dB\n",
+                      (unsigned long)samples[i].time, samples[i].rssi, samples[i].ber,
+                      samples[i].rsrp, samples[i].rsrq);
+    }
+    Serial.println(signalMonitor.isGood() ? "信号良好" : "信号较差");
+}
+
+void cmdPPP(const String &args) {
+    // 复制一份, 计数由工作任务中的PPP输入和协议栈任务更新
+    PPPLinkStats stats = modem.getPPPStats();
+    Serial.printf("MRU: 本端 %u, 对端 %u\n", stats.rxMru, stats.txMru);
+    Serial.printf("ACCM: 接收 0x%08lX, 发送 0x%08lX\n",
+                  (unsigned long)stats.rxAccm, (unsigned long)stats.txAccm);
+    Serial.printf("VJ压缩: 接收 %d, 发送 %d, ACFC: %d\n", stats.rxVj, stats.txVj, stats.acfc);
+    Serial.printf("发送: %lu 字节, 接收: %lu 字节, 开销: %.1f%%\n",
+                  (unsigned long)stats.txBytes, (unsigned long)stats.rxBytes,
+                  stats.overheadRatio() * 100);
+}
+
+void cmdQueue(const String &args) {
+    portENTER_CRITICAL(&statusLock);
+    QueueStatus status = queueStatus;
+    portEXIT_CRITICAL(&statusLock);
+
+    Serial.println(status.empty ? "队列为空" : "队列中有待上传数据");
+    Serial.println("丢弃的段: " + String(status.dropped));
+    if (status.waiting) {
+        Serial.printf("信号较差, 已推迟发送 %lu 秒\n", (unsigned long)(millis() - status.waitingSince) / 1000);
+    }
+}
+
+void cmdTrace(const String &args) {
+    if (args == "start") {
+        modem.startTrace(traceBuffer, sizeof(traceBuffer));
+    } else if (args == "stop") {
+        modem.stopTrace();
+    } else if (args == "dump") {
+        Serial.println("TRACE BEGIN " + String(modem.trace().length()));
+        modem.trace().dump(Serial);
+        Serial.println("TRACE END");
+    } else {
+        Serial.println("用法: trace start|stop|dump");
+    }
+}
+
+void runCaptureDump(const String &args) {
+    Serial.println("PCAP BEGIN");
+    size_t len = capture.dump(Serial);
+    Serial.println("PCAP END " + String(len));
+}
+
+void cmdCapture(const String &args) {
+    if (args.startsWith("start")) {
+        // 可选参数: 截取长度
+        long snapLen = args.substring(5).toInt();
+        if (snapLen > 0) {
+            // 不能超过缓冲区能容纳的单个包长度
+            uint16_t used = capture.setSnapLength(min(snapLen, 65535L));
+            if (used != snapLen) {
+                Serial.printf("截取长度超出缓冲区, 使用 %u 字节\n", used);
+            }
+        }
+        capture.clear();
+        capture.start();
+    } else if (args == "stop") {
+        capture.stop();
+    } else if (args == "dump") {
+        // 导出需要几秒, 交给工作任务, 不阻塞主循环
+        if (!worker.submit("capture", runCaptureDump)) {
+            Serial.println("命令队列已满, 请稍后重试");
+        }
+        return;
+    } else if (args.length() > 0) {
+        Serial.println("用法: capture [start [截取长度]|stop|dump]");
+        return;
+    }
+    Serial.printf("抓包: %s, 缓冲区 %u 个包, 累计 %lu (接收 %lu, 发送 %lu), 覆盖 %lu, 平均耗时 %.1f us\n",
+                  capture.isRunning() ? "进行中" : "停止", (unsigned)capture.packets(),
+                  (unsigned long)capture.captured(), (unsigned long)capture.received(),
+                  (unsigned long)capture.sent(), (unsigned long)capture.overwritten(),
+                  capture.overhead());
+}
+
+void runBridge(const String &args) {
+    bridge.run();
+    console.setSuspended(false);
+
+    // 桥接期间可能通过AT+IPR修改了波特率
+    modem.rememberBaudRate(modemSerial.baudRate());
+}
+
+void cmdBridge(const String &args) {
+    // 提交前暂停控制台, 之后的串口输入全部留给桥接转发给调制解调器
+    console.setSuspended(true);
+    if (!worker.submit("bridge", runBridge)) {
+        console.setSuspended(false);
+        Serial.println("命令队列已满, 请稍后重试");
+    }
+}
+
+void cmdOta(const String &args) {
+    // 参数: <服务器> <端口> <路径> <大小> <SHA-256>
+    char host[64], path[128], hex[65];
+    unsigned port;
+    unsigned long size;
+    uint8_t sha256[32];
+    if (sscanf(args.c_str(), "%63s %u %127s %lu %64s", host, &port, path, &size, hex) != 5 ||
+        strlen(hex) != 64) {
+        Serial.println("用法: ota <服务器> <端口> <路径> <大小> <SHA-256>");
+        return;
+    }
+    for (int i = 0; i < 32; i++) {
+        sscanf(hex + i * 2, "%2hhx", &sha256[i]);
+    }
+
+    if (!modem.checkPPPStatus()) {
+        Serial.println("PPP未连接");
+        return;
+    }
+
+    if (ota.update(host, port, path, size, sha256)) {
+        Serial.printf("固件更新完成, 平均速率 %lu 字节/秒, 3秒后重启\n", (unsigned long)ota.throughput());
+        delay(3000);
+        ESP.restart();
+    } else {
+        Serial.printf("固件更新未完成, 已写入 %lu 字节\n", (unsigned long)ota.offset());
+    }
+}
+
+// 选择上行方式: PPP已连接时使用TLS长连接, 否则小数据免拨号发送
+// @param limit 输出该方式单次上传的最大数据量
+Uplink *selectUplink(size_t &limit) {
+#ifdef DUAL_MODEM
+    // 使用链路管理选择的接口, 启用分流时每批轮流使用两条链路
+    struct netif *netif = links.nextNetif();
+    if (netif) {
+        TlsUplink *link = netif == modem2.getNetif() ? &uplink2 : &uplink;
+        link->setNetif(netif);
+        limit = UPLOAD_BATCH_SIZE;
+        return link;
+    }
+#else
+    if (modem.checkPPPStatus()) {
+        limit = UPLOAD_BATCH_SIZE;
+        return &uplink;
+    }
+#endif
+    if (socketPlaintext) {
+        limit = SOCKET_MAX_PAYLOAD;
+        return &socketUplink;
+    }
+    return nullptr;
+}
+
+// 批量上传队列中的记录, 每批在服务器确认后整批提交
+// 请求体由多条记录组成, 每条记录前加2字节长度(大端)
+uint32_t uploadQueue() {
+    if (!uplinkHost[0]) {
+        return 0;
+    }
+
+    static uint8_t batch[UPLOAD_BATCH_SIZE];
+    uint32_t sent = 0;
+    while (true) {
+        size_t limit;
+        Uplink *link = selectUplink(limit);
+        if (!link) {
+            break;
+        }
+
+        // 免拨号方式放不下的大记录等待PPP连接
+        uint32_t count;
+        size_t len = storeQueue.readBatch(batch, limit, count);
+        if (len == 0) {
+            break;
+        }
+        if (!link->send(batch, len)) {
+            storeQueue.rewind();
+            break;
+        }
+        storeQueue.commit();
+        sent += count;
+    }
+
+    // 释放模块socket, 以免影响之后的PPP拨号
+    socketUplink.close();
+    return sent;
+}
+
+// 没有可用的上行方式时拨号后发送
+void runDial(const String &args) {
+    dialQueued = false;
+    if (!modem.checkPPPStatus() && !modem.connect(modemApn)) {
+        LOG_W("拨号失败, 数据留在队列中等待下次发送");
+        return;
+    }
+    uploadQueue();
+}
+
+// 发送队列数据; 非紧急数据在信号较差时推迟, 超过最长推迟时间后照常发送
+uint32_t scheduleUpload(bool urgent) {
+    if (!uploadWaiting) {
+        uploadWaiting = true;
+        uploadWaitingSince = millis();
+    }
+    if (signalMonitor.shouldDefer(uploadWaitingSince, urgent)) {
+        return 0;
+    }
+    uploadWaiting = false;
+
+    // PPP未连接且不使用免拨号方式时, 拨号作为单独的任务排队, 不阻塞当前任务
+    size_t limit;
+    if (uplinkHost[0] && !storeQueue.empty() && !selectUplink(limit)) {
+#ifdef DUAL_MODEM
+        // 链路管理自行重拨断开的链路, 恢复后由工作任务空闲时发送
+        uploadWaiting = true;
+#else
+        if (!dialQueued) {
+            dialQueued = worker.submit("dial", runDial);
+        }
+#endif
+        return 0;
+    }
+    return uploadQueue();
+}
+
+// 结束当前液位数据块并写入队列
+void flushDepthBlock() {
+    if (depthEncoder.count() > 0) {
+        storeQueue.append(depthBlock, depthEncoder.finish());
+    }
+    depthEncoder.begin(depthBlock, sizeof(depthBlock));
+}
+
+// 按上报策略处理一个液位采样
+ReportAction reportDepth(const DepthSample &sample) {
+    ReportAction action = reportPolicy.add(sample);
+
+    // 告警通过短信发送, 不等待PPP连接
+    char text[64];
+    if (sample.depth >= ALARM_HIGH_LEVEL) {
+        snprintf(text, sizeof(text), "OVERFLOW level %.1fmm", sample.depth / 10.0);
+        smsAlarm.raise(ALARM_OVERFLOW, text);
+    }
+    if (reportPolicy.rate() <= -ALARM_DROP_RATE) {
+        snprintf(text, sizeof(text), "RAPID DROP %.1fmm/min level %.1fmm",
+                 reportPolicy.rate() / 10.0, sample.depth / 10.0);
+        smsAlarm.raise(ALARM_RAPID_DROP, text);
+    }
+    // 告警在上传之前发送, 不等上传(可能需要拨号)完成
+    smsAlarm.poll();
+
+    if (action == REPORT_SKIP) {
+        return action;
+    }
+    if (!depthEncoder.add(sample)) {
+        flushDepthBlock();
+        depthEncoder.add(sample);
+    }
+    if (action == REPORT_SEND) {
+        // 加注/抽取事件及时发送, 心跳和批量发送可以等待信号好转
+        flushDepthBlock();
+        scheduleUpload(reportPolicy.reason() & REPORT_REASON_EVENT);
+    }
+    return action;
+}
+
+// 液位传感器驱动, 由具体硬件实现; 未接入传感器时只能通过depth命令输入采样
+__attribute__((weak)) bool readDepthSensor(DepthSample &sample) {
+    return false;
+}
+
+// 到达上报策略给出的采样时间时读取传感器
+void sampleDepth() {
+    if ((int32_t)(millis() - nextDepthSample) < 0) {
+        return;
+    }
+
+    DepthSample sample;
+    sample.timestamp = time(nullptr);
+    if (readDepthSensor(sample)) {
+        reportDepth(sample);
+    }
+    nextDepthSample = millis() + reportPolicy.nextInterval() * 1000;
+}
+
+void cmdDepth(const String &args) {
+    // 参数: <液位(毫米)> [温度(摄氏度)], 手动输入一个采样
+    float depth, temperature = 0;
+    if (sscanf(args.c_str(), "%f %f", &depth, &temperature) < 1) {
+        Serial.println("用法: depth <液位(毫米)> [温度(摄氏度)]");
+        return;
+    }
+
+    DepthSample sample;
+    sample.timestamp = time(nullptr);
+    sample.depth = lroundf(depth * 10);
+    sample.temperature = lroundf(temperature * 10);
+    ReportAction action = reportDepth(sample);
+    nextDepthSample = millis() + reportPolicy.nextInterval() * 1000;
+
+    static const char *actions[] = {"丢弃", "记录", "发送"};
+    Serial.printf("处理结果: %s (原因 0x%02X), 速率 %.1f 毫米/分钟, 下次采样 %lu 秒后\n",
+                  actions[action], reportPolicy.reason(),
+                  reportPolicy.rate() / 10.0, (unsigned long)reportPolicy.nextInterval());
+}
+
+void cmdAlarm(const String &args) {
+    // 参数: [<号码>|test]
+    if (args == "test") {
+        smsAlarm.raise(ALARM_TEST, "TEST alarm");
+    } else if (args.length() > 0) {
+        smsAlarm.setRecipient(args.c_str());
+        Serial.println("告警号码: " + args);
+    }
+
+    const SmsAlarmStats &stats = smsAlarm.stats();
+    Serial.printf("待发送 %u, 已发送 %lu, 失败 %lu, 去重 %lu, 丢弃 %lu\n", (unsigned)smsAlarm.pending(),
+                  (unsigned long)stats.sent, (unsigned long)stats.failed,
+                  (unsigned long)stats.suppressed, (unsigned long)stats.dropped);
+    Serial.printf("最近一次告警到发送: %lu ms\n", (unsigned long)stats.lastLatency);
+}
+
+void cmdUpload(const String &args) {
+    // 参数: [<服务器> <HTTPS端口> <路径> [plaintext <HTTP端口>]], 省略时使用上次的服务器
+    // 指定plaintext时PPP未连接的小数据通过模块内置协议栈明文发送
+    if (args.length() > 0) {
+        char host[64], path[128], mode[16] = "";
+        unsigned port, httpPort = 0;
+        int n = sscanf(args.c_str(), "%63s %u %127s %15s %u", host, &port, path, mode, &httpPort);
+        if (n < 3 || (n > 3 && (strcmp(mode, "plaintext") != 0 || n < 5 || httpPort == 0))) {
+            Serial.println("用法: upload [<服务器> <HTTPS端口> <路径> [plaintext <HTTP端口>]]");
             return;
         }
-        
-        // 普通AT指令处理
-        if (command.length() > 0) {
-            Serial.println("\n发送命令: " + command);
-            String response = modem.sendCommand(command);
-            Serial.println("响应: " + response);
+        strcpy(uplinkHost, host);
+        strcpy(uplinkPath, path);
+        uplink.setServer(uplinkHost, port, uplinkPath);
+#ifdef DUAL_MODEM
+        uplink2.setServer(uplinkHost, port, uplinkPath);
+#endif
+        socketPlaintext = n == 5;
+        socketUplink.setServer(uplinkHost, httpPort, uplinkPath);
+        if (socketPlaintext) {
+            Serial.println("注意: PPP未连接时数据将以明文HTTP发送");
         }
     }
+    if (!uplinkHost[0]) {
+        Serial.println("未设置上行服务器");
+        return;
+    }
+
+    flushDepthBlock();
+    uint32_t sent = scheduleUpload(true);
+
+    const UplinkStats &stats = uplink.stats();
+    Serial.printf("本次上传 %lu 条, 剩余: %s\n", (unsigned long)sent, storeQueue.empty() ? "无" : "有");
+    Serial.printf("累计: 成功 %lu, 失败 %lu, 建立连接 %lu (会话恢复 %lu)\n",
+                  (unsigned long)stats.uploads, (unsigned long)stats.failures,
+                  (unsigned long)stats.connects, (unsigned long)stats.resumed);
+    Serial.printf("最近: 建立连接 %lu ms, 上传 %lu ms; DNS协议栈缓存应答 %lu, 网络查询 %lu\n",
+                  (unsigned long)stats.lastConnectMs, (unsigned long)stats.lastLatencyMs,
+                  (unsigned long)uplink.dns().cached(), (unsigned long)uplink.dns().queried());
+#ifdef DUAL_MODEM
+    const UplinkStats &stats2 = uplink2.stats();
+    Serial.printf("第二条链路: 成功 %lu, 失败 %lu, 建立连接 %lu; 故障切换 %lu 次, 最近耗时 %lu us\n",
+                  (unsigned long)stats2.uploads, (unsigned long)stats2.failures,
+                  (unsigned long)stats2.connects, (unsigned long)links.failovers(),
+                  (unsigned long)links.lastFailoverLatency());
+#endif
+
+    const UplinkStats &socketStats = socketUplink.stats();
+    Serial.printf("模块socket: 成功 %lu, 失败 %lu, 建立连接 %lu, 最近建立连接 %lu ms, 上传 %lu ms\n",
+                  (unsigned long)socketStats.uploads, (unsigned long)socketStats.failures,
+                  (unsigned long)socketStats.connects, (unsigned long)socketStats.lastConnectMs,
+                  (unsigned long)socketStats.lastLatencyMs);
+}
+
+void cmdProfile(const String &args) {
+    if (args == "clear") {
+        modem.clearProfile();
+        Serial.println("配置缓存已清除");
+        return;
+    }
+
+    const ModemProfile &profile = modem.profile();
+    Serial.println("缓存状态: " + String(modem.profileWarm() ? "启动时有效" : "启动时无效"));
+    Serial.printf("波特率: %lu\n", (unsigned long)profile.baud);
+    Serial.printf("IMEI: %s\n", profile.imei);
+    Serial.printf("模块信息: %s\n", profile.info);
+    Serial.printf("APN: %s\n", profile.apn);
+    Serial.printf("运营商: %s (格式 %u, 接入技术 %d)\n", profile.oper, profile.operFormat, profile.rat);
+    Serial.printf("启动到获取IP: %lu ms\n", (unsigned long)modem.bootToIpMs());
+}
+
+void cmdStatus(const String &args) {
+    const char *job = worker.currentJob();
+    Serial.println("PPP连接: " + String(modem.checkPPPStatus() ? "已连接" : "未连接"));
+    Serial.println("串口记录: " + String(modem.trace().isRecording() ? "进行中" : "未开启"));
+    Serial.println("当前任务: " + String(job ? job : "空闲"));
+    Serial.println("等待任务: " + String(worker.pending()) + ", 已完成: " + String(worker.completed()));
+}
+
+void cmdTasks(const String &args) {
+    // 任务表是采样时复制的快照; 数组较大, 不放在主循环栈上
+    static TaskProfile tasks[SysProfiler::MAX_TASKS];
+    size_t count = profiler.tasks(tasks, SysProfiler::MAX_TASKS);
+    Serial.printf("任务数: %u\n", (unsigned)uxTaskGetNumberOfTasks());
+    for (size_t i = 0; i < count; i++) {
+        Serial.printf("  %-16s 栈剩余 %5lu 字节, CPU %5.1f%%\n", tasks[i].name,
+                      (unsigned long)tasks[i].stackFree, tasks[i].cpu / 10.0);
+    }
+    Serial.printf("主循环栈剩余: %u 字节, 工作任务栈剩余: %u 字节\n",
+                  (unsigned)uxTaskGetStackHighWaterMark(loopTask),
+                  (unsigned)uxTaskGetStackHighWaterMark(worker.handle()));
+    Serial.printf("主循环间隔: 最大 %lu us\n", (unsigned long)loopMaxGap);
+    loopMaxGap = 0;
+}
+
+void cmdSys(const String &args) {
+    if (args == "record") {
+        // 资源记录与测量数据一起排队上传
+        uint8_t record[SysProfiler::RECORD_SIZE];
+        size_t len = profiler.record(record, sizeof(record));
+        if (len > 0 && storeQueue.append(record, len)) {
+            Serial.println("资源记录已加入上传队列");
+        } else {
+            Serial.println("资源记录写入失败");
+        }
+        return;
+    }
+
+    ResourceSample samples[8];
+    size_t n = profiler.history(samples, 8);
+    for (size_t i = 0; i < n; i++) {
+        const ResourceSample &s = samples[i];
+        Serial.printf("%lu ms: 空闲堆 %lu, 最小 %lu, 最大块 %lu, 碎片 %u%%, CPU %.1f%%, 最小栈 %u, 标志 0x%02X\n",
+                      (unsigned long)s.time, (unsigned long)s.freeHeap, (unsigned long)s.minFreeHeap,
+                      (unsigned long)s.largestBlock, s.fragmentation, s.cpuLoad / 10.0, s.minStack, s.flags);
+    }
+    Serial.printf("采样耗时: %lu us\n", (unsigned long)profiler.overhead());
+}
+
+void cmdAT(const String &line) {
+    Serial.println("\n发送命令: " + line);
+    String response = modem.sendCommand(line);
+    Serial.println("响应: " + response);
+}
+
+void cmdHelp(const String &args);
+
+// 读写调制解调器或工作任务所用数据的命令都交给工作任务执行;
+// 查询命令只读取快照或加锁的数据, 在主循环中执行, 工作任务正在拨号等长任务时也能立即查询
+// bridge 需要在提交前暂停控制台, 由它自己提交桥接任务; capture dump 输出较长, 同样自行提交
+const ConsoleCommand commands[] = {
+    {"help", "显示命令列表", cmdHelp, false},
+    {"test", "执行基础功能测试", cmdTest, true},
+    {"connect", "执行PPP拨号测试", cmdConnect, true},
+    {"csq", "查看信号质量历史", cmdCsq, false},
+    {"ppp", "查看PPP链路协商结果和统计", cmdPPP, false},
+    {"queue", "查看待上传数据队列", cmdQueue, false},
+    {"trace", "start/stop/dump 记录/导出串口数据", cmdTrace, true},
+    {"capture", "[start [截取长度]|stop|dump] PPP抓包, 导出pcap(十六进制, 用 xxd -r -p 还原)", cmdCapture, false},
+    {"bridge", "USB串口与调制解调器透明桥接, 静默1秒后发送~~~退出", cmdBridge, false},
+    {"ota", "<服务器> <端口> <路径> <大小> <SHA-256> 通过PPP升级固件", cmdOta, true},
+    {"depth", "<液位(毫米)> [温度] 按上报策略处理一个液位采样", cmdDepth, true},
+    {"alarm", "[<号码>|test] 设置告警短信号码/发送测试告警", cmdAlarm, true},
+    {"upload", "[<服务器> <HTTPS端口> <路径> [plaintext <HTTP端口>]] 上传队列数据", cmdUpload, true},
+    {"profile", "[clear] 查看/清除调制解调器配置缓存", cmdProfile, true},
+    {"status", "查看调制解调器和工作任务状态", cmdStatus, false},
+    {"tasks", "查看各任务栈余量、CPU占用和主循环延迟", cmdTasks, false},
+    {"sys", "[record] 查看堆和CPU历史/把资源记录加入上传队列", cmdSys, true},
+};
+
+void cmdHelp(const String &args) {
+    console.printHelp();
+}
+
+// 更新队列状态快照, 在工作任务中调用
+void publishQueueStatus() {
+    QueueStatus status = {storeQueue.empty(), storeQueue.droppedSegments(), uploadWaiting, uploadWaitingSince};
+    portENTER_CRITICAL(&statusLock);
+    queueStatus = status;
+    portEXIT_CRITICAL(&statusLock);
+}
+
+// 工作任务空闲时处理PPP输入并定期采样信号质量
+void modemIdle() {
+#ifdef DUAL_MODEM
+    links.poll();
+    // 主链路重拨期间由重拨任务独占
+    if (links.dialing(0)) {
+        return;
+    }
+#else
+    modem.poll();
+#endif
+    signalMonitor.sample();
+}
+
+// 工作任务没有任务时额外按时采样液位、发送待发的告警短信和推迟的数据
+void workerIdle() {
+    modemIdle();
+    sampleDepth();
+#ifdef DUAL_MODEM
+    // 主链路重拨期间告警短信等待
+    if (!links.dialing(0)) {
+        smsAlarm.poll();
+    }
+#else
+    smsAlarm.poll();
+#endif
+    if (uploadWaiting) {
+        scheduleUpload(false);
+    }
+    publishQueueStatus();
+}
+
+// 固件下载期间只处理PPP输入: 告警短信需要退出数据模式, 上报会在同一链路上建立TLS连接,
+// 都会打断下载, 留到下载结束后由 workerIdle 处理
+void otaIdle() {
+#ifdef DUAL_MODEM
+    links.poll();
+#else
+    modem.poll();
+#endif
 }
 
 void setup() {
@@ -137,45 +753,99 @@ void setup() {
     
     LOG_MODULE("MAIN");
     LOG_I("系统启动");
+    loopTask = xTaskGetCurrentTaskHandle();
     
     // 初始化调试串口
     Serial.println("\n============================");
     Serial.println("调制解调器测试程序启动...");
     Serial.println("============================");
 
-    // 初始化modem串口
-    modemSerial.begin(115200, SERIAL_8N1, 16, 17);
+    // 初始化待上传数据队列
+    if (!LittleFS.begin(true) || !storeQueue.begin()) {
+        Serial.println("数据队列初始化失败!");
+    }
+    reportPolicy.begin();
+    capture.begin(captureBuffer, sizeof(captureBuffer));
+    modem.setCapture(&capture);
+    depthEncoder.begin(depthBlock, sizeof(depthBlock));
+
+    // 初始化modem串口, 优先使用上次可用的波特率
+    uint32_t baud = modem.profile().baud ? modem.profile().baud : MODEM_BAUD;
+    modemSerial.begin(baud, SERIAL_8N1, 16, 17);
     
     // 初始化modem
-    if (!modem.begin(modemSerial)) {
-        Serial.println("调制解调器初始化失败!");
-        return;
+    bool ready = modem.begin(modemSerial);
+    if (!ready && baud != MODEM_BAUD) {
+        LOG_W("缓存的波特率无响应, 使用默认波特率");
+        baud = MODEM_BAUD;
+        modemSerial.updateBaudRate(baud);
+        ready = modem.isReady();
+        // 缓存的波特率不可用, 可能更换了模块
+        if (ready) {
+            modem.revalidateProfile();
+        }
     }
-    Serial.println("调制解调器初始化成功!");
-    
-    // 获取网络时间并更新RTC
-    time_t networkTime = modem.getNetworkTime();
-    if (networkTime > 0) {
-        Serial.println("网络时间同步成功: " + String(networkTime));
+    if (ready) {
+        Serial.println("调制解调器初始化成功!");
+        modem.rememberBaudRate(baud);
+
+        // 获取网络时间并更新RTC
+        time_t networkTime = modem.getNetworkTime();
+        if (networkTime > 0) {
+            Serial.println("网络时间同步成功: " + String(networkTime));
+        } else {
+            Serial.println("网络时间同步失败");
+        }
+
+        // 执行基础功能测试
+        testModemBasicFunctions();
+
+        // 添加模式检测测试
+        testModemMode();
     } else {
-        Serial.println("网络时间同步失败");
+        Serial.println("调制解调器初始化失败!");
     }
-    
-    // 执行基础功能测试
-    testModemBasicFunctions();
-    
-    // 添加模式检测测试
-    testModemMode();
-    
-    Serial.println("\n============================");
-    Serial.println("可用命令:");
-    Serial.println("1. test  - 执行基础功能测试");
-    Serial.println("2. connect  - 执行PPP拨号测试");
-    Serial.println("3. 直接输入AT指令");
-    Serial.println("============================\n");
+
+    // 固件下载限速, 避免长时间占满链路
+    ota.setThrottle(4096);
+    ota.setIdleHandler(otaIdle);
+    uplink.setIdleHandler(modemIdle);
+    socketUplink.setIdleHandler(modemIdle);
+    socketUplink.setAPN(modemApn);
+
+#ifdef DUAL_MODEM
+    // 两条链路都拨号, 之后断开的链路由链路管理在后台重拨
+    modem2Serial.begin(MODEM_BAUD, SERIAL_8N1, MODEM2_RX, MODEM2_TX);
+    if (!modem2.begin(modem2Serial)) {
+        Serial.println("第二个调制解调器初始化失败!");
+    }
+    uplink2.setIdleHandler(modemIdle);
+    links.setAPN(modemApn);
+    if (!links.begin()) {
+        Serial.println("两条链路都未连接, 等待重拨");
+    }
+#endif
+
+    // 此后调制解调器只由工作任务访问
+    publishQueueStatus();
+    worker.setIdleHandler(workerIdle);
+    worker.begin();
+    console.begin(Serial, commands, sizeof(commands) / sizeof(commands[0]), worker);
+    console.setFallback(cmdAT);
+    console.printHelp();
 }
 
 void loop() {
+    static uint32_t lastLoop = micros();
+    uint32_t now = micros();
+    loopMaxGap = max(loopMaxGap, now - lastLoop);
+    lastLoop = now;
+
     // 处理串口命令
-    processSerialCommand();
+    console.poll();
+
+    // 定期采样系统资源
+    profiler.sample();
+
+    delay(1);
 }
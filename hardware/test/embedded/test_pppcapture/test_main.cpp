@@ -0,0 +1,108 @@
+/*
+ * PPP抓包上板测试: pio test -e esp32dev
+ * 需要连接调制解调器(串口1, RX 16 / TX 17)和可用的SIM卡;
+ * 拨号后做一次DNS查询, 检查发送和接收两个方向都被抓到, 且接收的包是IPv4包
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include "modem.h"
+#include "pppcapture.h"
+#include "dnsresolver.h"
+
+#define MODEM_BAUD 115200
+
+HardwareSerial modemSerial(1);
+static uint8_t captureBuffer[8 * 1024];
+static PppCapture capture;
+
+// 把导出的十六进制文本还原为pcap文件
+class HexSink : public Print
+{
+public:
+    size_t write(uint8_t c) override
+    {
+        if (!isxdigit(c))
+        {
+            return 1;
+        }
+        uint8_t value = isdigit(c) ? c - '0' : toupper(c) - 'A' + 10;
+        if (_high && len < sizeof(data))
+        {
+            data[len++] = (_nibble << 4) | value;
+        }
+        _nibble = value;
+        _high = !_high;
+        return 1;
+    }
+
+    uint8_t data[sizeof(captureBuffer) + 1024];
+    size_t len = 0;
+
+private:
+    uint8_t _nibble = 0;
+    bool _high = false;
+};
+
+static uint32_t readLE32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void pump()
+{
+    modem.poll();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_capture_both_directions()
+{
+    modemSerial.begin(MODEM_BAUD, SERIAL_8N1, 16, 17);
+    TEST_ASSERT_TRUE_MESSAGE(modem.begin(modemSerial), "调制解调器无响应");
+
+    capture.begin(captureBuffer, sizeof(captureBuffer));
+    modem.setCapture(&capture);
+    TEST_ASSERT_TRUE_MESSAGE(modem.connect("CMNET"), "PPP拨号失败");
+    capture.start();
+
+    // 发送方向为查询, 接收方向为应答
+    DnsResolver dns;
+    dns.setIdleHandler(pump);
+    ip4_addr_t addr;
+    TEST_ASSERT_TRUE_MESSAGE(dns.resolve("example.com", addr), "DNS查询失败");
+    capture.stop();
+
+    TEST_ASSERT_GREATER_THAN(0, capture.sent());
+    TEST_ASSERT_GREATER_THAN(0, capture.received());
+
+    // 文件头24字节, 每个包前16字节包头(第3个字段为保存长度), 包内容应为IPv4
+    static HexSink pcap;
+    capture.dump(pcap);
+    size_t pos = 24;
+    size_t packets = 0;
+    while (pos + 16 < pcap.len)
+    {
+        uint32_t capLen = readLE32(pcap.data + pos + 8);
+        TEST_ASSERT_EQUAL(4, pcap.data[pos + 16] >> 4);
+        pos += 16 + capLen;
+        packets++;
+    }
+    TEST_ASSERT_EQUAL(pcap.len, pos);
+    TEST_ASSERT_EQUAL(capture.packets(), packets);
+
+    modem.hangup();
+}
+
+void setup()
+{
+    // 等待串口监视器连接
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_both_directions);
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,269 @@
+/*
+ * 主机端单元测试用的最小 Arduino 接口
+ * 只实现被测库用到的部分: 计时、String、Print/Stream、可安排输入的串口和输出到标准输出的 Serial
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::max;
+using std::min;
+
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+#define ARDUINO_RUNNING_CORE 1
+
+inline unsigned long micros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+inline unsigned long millis() { return micros() / 1000; }
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() { std::this_thread::yield(); }
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+class String : public std::string
+{
+public:
+    String() {}
+    String(const char *s) : std::string(s ? s : "") {}
+    String(const std::string &s) : std::string(s) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(int v) : std::string(std::to_string(v)) {}
+    explicit String(unsigned int v) : std::string(std::to_string(v)) {}
+    explicit String(long v) : std::string(std::to_string(v)) {}
+    explicit String(unsigned long v) : std::string(std::to_string(v)) {}
+    explicit String(float v, unsigned int digits = 2) : String((double)v, digits) {}
+    explicit String(double v, unsigned int digits = 2)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", (int)digits, v);
+        assign(buf);
+    }
+
+    unsigned int length() const { return size(); }
+    bool reserve(unsigned int n)
+    {
+        std::string::reserve(n);
+        return true;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return _pos(find(c, from)); }
+    int indexOf(const char *s, unsigned int from = 0) const { return _pos(find(s, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return _pos(find(s, from)); }
+    int lastIndexOf(char c) const { return _pos(rfind(c)); }
+    bool startsWith(const String &s) const { return compare(0, s.size(), s) == 0; }
+    bool endsWith(const String &s) const { return size() >= s.size() && compare(size() - s.size(), s.size(), s) == 0; }
+    String substring(unsigned int from) const { return from > size() ? String() : String(substr(from)); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        return from > size() || to < from ? String() : String(substr(from, to - from));
+    }
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return atof(c_str()); }
+    void trim()
+    {
+        size_t b = find_first_not_of(" \t\r\n");
+        size_t e = find_last_not_of(" \t\r\n");
+        *this = b == npos ? String() : String(substr(b, e - b + 1));
+    }
+    void toLowerCase() { std::transform(begin(), end(), begin(), ::tolower); }
+    void toUpperCase() { std::transform(begin(), end(), begin(), ::toupper); }
+
+    String &operator+=(const String &s)
+    {
+        append(s);
+        return *this;
+    }
+    String &operator+=(const char *s)
+    {
+        append(s);
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        push_back(c);
+        return *this;
+    }
+
+private:
+    static int _pos(size_t p) { return p == npos ? -1 : (int)p; }
+};
+
+inline String operator+(const String &a, const String &b)
+{
+    return String(static_cast<const std::string &>(a) + static_cast<const std::string &>(b));
+}
+inline String operator+(const String &a, const char *b) { return String(static_cast<const std::string &>(a) + b); }
+inline String operator+(const char *a, const String &b) { return String(a + static_cast<const std::string &>(b)); }
+inline String operator+(const String &a, char b) { return String(static_cast<const std::string &>(a) + b); }
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t len)
+    {
+        size_t n = 0;
+        while (n < len && write(data[n]))
+        {
+            n++;
+        }
+        return n;
+    }
+    virtual void flush() {}
+
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &v) { return print(v) + println(); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#include <stdarg.h>
+inline size_t Print::printf(const char *format, ...)
+{
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return n > 0 ? write((const uint8_t *)buf, min((size_t)n, sizeof(buf) - 1)) : 0;
+}
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { _timeout = ms; }
+    size_t readBytes(uint8_t *buffer, size_t len)
+    {
+        size_t n = 0;
+        unsigned long start = millis();
+        while (n < len && millis() - start < _timeout)
+        {
+            int c = read();
+            if (c >= 0)
+            {
+                buffer[n++] = (uint8_t)c;
+            }
+        }
+        return n;
+    }
+    size_t readBytes(char *buffer, size_t len) { return readBytes((uint8_t *)buffer, len); }
+
+protected:
+    unsigned long _timeout = 1000;
+};
+
+// 默认输出到标准输出、没有输入; 测试可以按时间安排输入并记录输出, 模拟连接的设备
+class HardwareSerial : public Stream
+{
+public:
+    int available() override
+    {
+        size_t n = 0;
+        while (_rxPos + n < _rx.size() && _rx[_rxPos + n].at <= millis())
+        {
+            n++;
+        }
+        return n;
+    }
+    int read() override { return available() > 0 ? _rx[_rxPos++].c : -1; }
+    int peek() override { return available() > 0 ? _rx[_rxPos].c : -1; }
+    size_t read(uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && available() > 0)
+        {
+            buffer[n++] = _rx[_rxPos++].c;
+        }
+        return n;
+    }
+    int availableForWrite() { return 128; }
+
+    size_t write(uint8_t c) override
+    {
+        if (_recording)
+        {
+            output += (char)c;
+            return 1;
+        }
+        return fputc(c, stdout) == EOF ? 0 : 1;
+    }
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        if (_recording)
+        {
+            output.append((const char *)data, len);
+            return len;
+        }
+        return fwrite(data, 1, len, stdout);
+    }
+    using Print::write;
+
+    void begin(unsigned long baud) { _baud = baud; }
+    void updateBaudRate(unsigned long baud) { _baud = baud; }
+    uint32_t baudRate() { return _baud; }
+
+    /**
+     * 安排输入数据, 在 delayMs 毫秒后可读
+     */
+    void feed(const String &data, uint32_t delayMs = 0)
+    {
+        uint32_t at = millis() + delayMs;
+        for (char c : data)
+        {
+            _rx.push_back({at, (uint8_t)c});
+        }
+    }
+
+    /**
+     * 输出记录到 output, 不再打印
+     */
+    void record() { _recording = true; }
+
+    String output;
+
+private:
+    struct Input
+    {
+        uint32_t at;
+        uint8_t c;
+    };
+
+    std::vector<Input> _rx;
+    size_t _rxPos = 0;
+    bool _recording = false;
+    uint32_t _baud = 115200;
+};
+
+inline HardwareSerial Serial;
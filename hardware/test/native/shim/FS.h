@@ -0,0 +1,112 @@
+/*
+ * 主机端单元测试用的文件系统接口, 以主机目录模拟闪存文件系统
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+
+class File
+{
+public:
+    File() {}
+
+    operator bool() const { return _file || _isDir; }
+    bool isDirectory() const { return _isDir; }
+    const char *name() const { return _path.c_str(); }
+
+    size_t write(const uint8_t *data, size_t len) { return _file ? fwrite(data, 1, len, _file.get()) : 0; }
+    size_t read(uint8_t *data, size_t len) { return _file ? fread(data, 1, len, _file.get()) : 0; }
+    bool seek(uint32_t pos) { return _file && fseek(_file.get(), pos, SEEK_SET) == 0; }
+    size_t size() const
+    {
+        std::error_code ec;
+        size_t n = std::filesystem::file_size(_path, ec);
+        return ec ? 0 : n;
+    }
+    void flush()
+    {
+        if (_file)
+        {
+            fflush(_file.get());
+        }
+    }
+    void close()
+    {
+        _file.reset();
+        _isDir = false;
+    }
+
+    File openNextFile()
+    {
+        File f;
+        if (_next < _entries.size())
+        {
+            f._path = _entries[_next++];
+            f._file.reset(fopen(f._path.c_str(), "rb"), fclose);
+        }
+        return f;
+    }
+
+private:
+    friend class FS;
+
+    std::shared_ptr<FILE> _file;
+    std::string _path;
+    bool _isDir = false;
+    std::vector<std::string> _entries;
+    size_t _next = 0;
+};
+
+class FS
+{
+public:
+    /**
+     * @param root 主机上作为文件系统根目录的目录
+     */
+    explicit FS(const std::string &root) : _root(root) {}
+
+    bool exists(const String &path) const { return std::filesystem::exists(_root + path.c_str()); }
+    bool mkdir(const String &path) const { return std::filesystem::create_directories(_root + path.c_str()); }
+    bool remove(const String &path) const { return std::filesystem::remove(_root + path.c_str()); }
+
+    File open(const String &path, const char *mode = FILE_READ) const
+    {
+        File f;
+        std::string p = _root + path.c_str();
+        if (std::filesystem::is_directory(p))
+        {
+            f._isDir = true;
+            f._path = p;
+            for (const auto &entry : std::filesystem::directory_iterator(p))
+            {
+                f._entries.push_back(entry.path().string());
+            }
+            return f;
+        }
+        const char *m = mode[0] == 'w' ? "wb" : mode[0] == 'a' ? "ab" : "rb";
+        FILE *file = fopen(p.c_str(), m);
+        if (file)
+        {
+            f._file.reset(file, fclose);
+            f._path = p;
+        }
+        return f;
+    }
+
+private:
+    std::string _root;
+};
+
+} // namespace fs
+
+using fs::File;
@@ -0,0 +1,20 @@
+/*
+ * 主机端单元测试用的 CRC32 (与 ESP32 ROM 中 esp_rom_crc32_le 结果一致)
+ */
+#pragma once
+
+#include <stdint.h>
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
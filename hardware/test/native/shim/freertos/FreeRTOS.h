@@ -0,0 +1,10 @@
+/*
+ * 主机端单元测试用的 FreeRTOS 临界区接口, 测试在单线程中运行, 临界区为空操作
+ */
+#pragma once
+
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
@@ -0,0 +1,29 @@
+/*
+ * 主机端单元测试用的 FreeRTOS 任务接口
+ * 测试在单线程中运行: 创建的任务在创建时同步运行完毕, 延时直接休眠
+ */
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <stdint.h>
+#include <chrono>
+#include <thread>
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) (ms)
+
+inline void vTaskDelay(uint32_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+inline void taskYIELD() { std::this_thread::yield(); }
+inline void vTaskDelete(TaskHandle_t task) {}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackSize, void *arg,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    task(arg);
+    return pdPASS;
+}
@@ -0,0 +1,56 @@
+/*
+ * 主机端单元测试用的最小 lwIP 网络接口定义, 只包含被测库用到的类型
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+
+typedef struct
+{
+    uint32_t addr;
+} ip4_addr_t;
+
+struct pbuf
+{
+    struct pbuf *next;
+    void *payload;
+    uint16_t tot_len;
+    uint16_t len;
+};
+
+struct netif;
+typedef err_t (*netif_output_fn)(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr);
+
+struct netif
+{
+    netif_output_fn output;
+    void *state;
+};
+
+inline struct netif *netif_default = nullptr;
+
+inline uint16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, uint16_t len, uint16_t offset)
+{
+    uint16_t copied = 0;
+    for (; p && copied < len; p = p->next)
+    {
+        if (offset >= p->len)
+        {
+            offset -= p->len;
+            continue;
+        }
+        uint16_t n = p->len - offset;
+        if (n > len - copied)
+        {
+            n = len - copied;
+        }
+        memcpy((uint8_t *)dataptr + copied, (const uint8_t *)p->payload + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
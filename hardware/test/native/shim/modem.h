@@ -0,0 +1,247 @@
+/*
+ * 主机端单元测试用的调制解调器替身
+ * Modem 只实现被测库用到的接口, 通过Stream收发AT指令; SimModule 模拟模块的应答、
+ * 拨号后的数据模式和掉线. 真实的 lib/modem 依赖PPP协议栈, 主机端测试不编译它
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <lwip/netif.h>
+
+// 模拟的模块: 按设置的应答回复AT指令, ATD后进入数据模式并统计收到的字节
+class SimModule : public Stream
+{
+public:
+    /**
+     * 设置指令的应答, 未设置的指令回复OK
+     * @param command 指令(不含回车)
+     * @param response 应答, 不含结果码时追加OK
+     */
+    void reply(const String &command, const String &response) { _replies[command] = response; }
+
+    /**
+     * 设置拨号是否成功
+     */
+    void setDialResult(bool ok) { _dialOk = ok; }
+
+    /**
+     * 在数据模式中掉线: 回到命令模式并发出 NO CARRIER
+     */
+    void dropCarrier()
+    {
+        if (_dataMode)
+        {
+            _dataMode = false;
+            _rx += "\r\nNO CARRIER\r\n";
+        }
+    }
+
+    bool dataMode() const { return _dataMode; }
+    size_t dataBytes() const { return _dataBytes; }   // 数据模式中收到的字节数
+    size_t commands(const String &command) const      // 收到某条指令的次数
+    {
+        auto it = _counts.find(command);
+        return it == _counts.end() ? 0 : it->second;
+    }
+
+    int available() override { return _rx.size() - _rxPos; }
+    int read() override { return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos++] : -1; }
+    int peek() override { return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos] : -1; }
+
+    size_t write(uint8_t c) override
+    {
+        if (_dataMode)
+        {
+            // "+++" 退出数据模式
+            _dataBytes++;
+            _plus = c == '+' ? _plus + 1 : 0;
+            if (_plus == 3)
+            {
+                _dataMode = false;
+                _plus = 0;
+                _rx += "\r\nOK\r\n";
+            }
+            return 1;
+        }
+        if (c == '\r' || c == '\n')
+        {
+            if (!_line.empty())
+            {
+                _command(_line);
+                _line.clear();
+            }
+        }
+        else
+        {
+            _line += (char)c;
+        }
+        return 1;
+    }
+    using Print::write;
+
+private:
+    void _command(const String &command)
+    {
+        _counts[command]++;
+        if (command.startsWith("ATD"))
+        {
+            _dataMode = _dialOk;
+            _rx += _dialOk ? "\r\nCONNECT\r\n" : "\r\nNO CARRIER\r\n";
+            return;
+        }
+        auto it = _replies.find(command);
+        String response = it == _replies.end() ? String() : it->second;
+        if (response.indexOf("OK") < 0 && response.indexOf("ERROR") < 0)
+        {
+            response += response.empty() ? "OK" : "\r\n\r\nOK";
+        }
+        _rx += "\r\n" + response + "\r\n";
+    }
+
+    std::map<std::string, String> _replies;
+    std::map<std::string, size_t> _counts;
+    String _rx;
+    size_t _rxPos = 0;
+    String _line;
+    bool _dataMode = false;
+    bool _dialOk = true;
+    int _plus = 0;
+    size_t _dataBytes = 0;
+};
+
+class Modem
+{
+public:
+    explicit Modem(const char *name = "MODEM") : _name(name)
+    {
+        _netif.output = _output;
+        _netif.state = this;
+    }
+
+    const char *name() const { return _name; }
+
+    bool begin(Stream &uart)
+    {
+        _uart = &uart;
+        return true;
+    }
+
+    String sendCommand(const String &command, uint32_t timeout = 1000)
+    {
+        if (!_uart || _connected)
+        {
+            return "";
+        }
+        _uart->print(command);
+        _uart->print("\r\n");
+        String response;
+        _readUntil(response, timeout);
+        return response;
+    }
+
+    bool connect(const char *apn, const char *username = "", const char *password = "")
+    {
+        if (!_uart)
+        {
+            return false;
+        }
+        sendCommand(String("AT+CGDCONT=1,\"IP\",\"") + apn + "\"");
+        _uart->print("ATD*99#\r\n");
+        String response;
+        _readUntil(response, 1000);
+        _connected = response.indexOf("CONNECT") >= 0;
+        return _connected;
+    }
+
+    bool hangup()
+    {
+        if (_connected)
+        {
+            _connected = false;
+            _uart->print("+++");
+            String response;
+            _readUntil(response, 1000);
+        }
+        return sendCommand("ATH").indexOf("OK") >= 0;
+    }
+
+    // 数据模式中检查掉线
+    void poll()
+    {
+        while (_connected && _uart && _uart->available())
+        {
+            char c = _uart->read();
+            _line += c;
+            if (c == '\n')
+            {
+                if (_line.indexOf("NO CARRIER") >= 0)
+                {
+                    _connected = false;
+                    _linkLostAt = micros();
+                }
+                _line.clear();
+            }
+        }
+    }
+
+    bool checkPPPStatus() { return _connected; }
+
+    void setDefaultRoute(bool enable) { _defaultRoute = enable; }
+    bool defaultRoute() const { return _defaultRoute; }
+
+    bool setDefault()
+    {
+        if (!_connected)
+        {
+            return false;
+        }
+        netif_default = &_netif;
+        return true;
+    }
+
+    struct netif *getNetif() { return _connected ? &_netif : nullptr; }
+
+    uint32_t linkLostAt() const { return _linkLostAt; }
+
+private:
+    // 读取到结果码或超时
+    void _readUntil(String &response, uint32_t timeout)
+    {
+        unsigned long start = millis();
+        while (millis() - start < timeout)
+        {
+            int c = _uart->read();
+            if (c < 0)
+            {
+                yield();
+                continue;
+            }
+            response += (char)c;
+            if (response.endsWith("OK\r\n") || response.endsWith("ERROR\r\n") ||
+                response.endsWith("CONNECT\r\n") || response.endsWith("NO CARRIER\r\n"))
+            {
+                return;
+            }
+        }
+    }
+
+    // 数据模式中发送的包原样写入串口
+    static err_t _output(struct netif *netif, struct pbuf *p, const ip4_addr_t *addr)
+    {
+        Modem *modem = (Modem *)netif->state;
+        for (struct pbuf *q = p; q; q = q->next)
+        {
+            modem->_uart->write((const uint8_t *)q->payload, q->len);
+        }
+        return ERR_OK;
+    }
+
+    const char *_name;
+    Stream *_uart = nullptr;
+    bool _connected = false;
+    bool _defaultRoute = true;
+    uint32_t _linkLostAt = 0;
+    String _line;
+    struct netif _netif = {};
+};
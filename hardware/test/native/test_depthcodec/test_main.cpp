@@ -0,0 +1,219 @@
+/*
+ * 液位时间序列编解码测试
+ * 覆盖编码/解码往返、游程编码、时间戳大幅跳变和缓冲区满, 并输出典型数据的压缩率
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "depthcodec.h"
+
+// 把采样编码为若干数据块, 缓冲区满或 add() 拒绝时开始新块(与固件的用法相同)
+static std::vector<std::vector<uint8_t>> encode(const std::vector<DepthSample> &samples, size_t blockSize,
+                                                bool rle = true)
+{
+    std::vector<std::vector<uint8_t>> blocks;
+    std::vector<uint8_t> buffer(blockSize);
+    DepthEncoder encoder;
+    encoder.begin(buffer.data(), buffer.size(), rle);
+    for (const DepthSample &s : samples)
+    {
+        if (!encoder.add(s))
+        {
+            size_t len = encoder.finish();
+            blocks.emplace_back(buffer.begin(), buffer.begin() + len);
+            encoder.begin(buffer.data(), buffer.size(), rle);
+            TEST_ASSERT_TRUE(encoder.add(s));
+        }
+    }
+    if (encoder.count() > 0)
+    {
+        size_t len = encoder.finish();
+        blocks.emplace_back(buffer.begin(), buffer.begin() + len);
+    }
+    return blocks;
+}
+
+static std::vector<DepthSample> decode(const std::vector<std::vector<uint8_t>> &blocks)
+{
+    std::vector<DepthSample> samples;
+    DepthDecoder decoder;
+    for (const auto &block : blocks)
+    {
+        TEST_ASSERT_TRUE(decoder.begin(block.data(), block.size()));
+        DepthSample s;
+        while (decoder.next(s))
+        {
+            samples.push_back(s);
+        }
+    }
+    return samples;
+}
+
+static void assertRoundTrip(const std::vector<DepthSample> &samples, size_t blockSize, bool rle = true)
+{
+    std::vector<DepthSample> decoded = decode(encode(samples, blockSize, rle));
+    TEST_ASSERT_EQUAL(samples.size(), decoded.size());
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(samples[i].timestamp, decoded[i].timestamp);
+        TEST_ASSERT_EQUAL_INT32(samples[i].depth, decoded[i].depth);
+        TEST_ASSERT_EQUAL_INT16(samples[i].temperature, decoded[i].temperature);
+    }
+}
+
+static size_t totalSize(const std::vector<std::vector<uint8_t>> &blocks)
+{
+    size_t n = 0;
+    for (const auto &block : blocks)
+    {
+        n += block.size();
+    }
+    return n;
+}
+
+// 典型液位记录: 静止、加注、静止、缓慢消耗, 每分钟一个采样, 偶有采样时间抖动
+static std::vector<DepthSample> tankTrace()
+{
+    std::vector<DepthSample> samples;
+    uint32_t ts = 1700000000;
+    int32_t depth = 52000;
+    int16_t temp = 215;
+    uint32_t seed = 1;
+    for (int i = 0; i < 1440; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if (i >= 300 && i < 360)
+        {
+            depth += 150;   // 加注
+        }
+        else if (i >= 800)
+        {
+            depth -= (seed >> 16) % 3 == 0 ? 1 : 0;   // 缓慢消耗
+        }
+        if (i % 60 == 0)
+        {
+            temp += (int16_t)((seed >> 20) % 3) - 1;
+        }
+        ts += 60 + ((seed >> 24) % 16 == 0 ? 1 : 0);
+        samples.push_back({ts, depth, temp});
+    }
+    return samples;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_round_trip()
+{
+    std::vector<DepthSample> samples;
+    uint32_t seed = 7;
+    uint32_t ts = 1000;
+    for (int i = 0; i < 500; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        ts += 1 + (seed >> 16) % 600;
+        samples.push_back({ts, (int32_t)(seed >> 8) % 200000 - 100000, (int16_t)((seed >> 4) % 1000 - 400)});
+    }
+    assertRoundTrip(samples, 256);
+    assertRoundTrip(samples, 4096, false);
+}
+
+void test_run_length_blocks()
+{
+    // 长时间静止的液位压缩成游程
+    std::vector<DepthSample> samples;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        samples.push_back({1700000000 + i * 60, 52000, 215});
+    }
+    samples.push_back({1700000000 + 1000 * 60, 52010, 215});
+    samples.push_back({1700000000 + 1001 * 60, 52010, 215});
+
+    auto blocks = encode(samples, 256);
+    TEST_ASSERT_EQUAL(1, blocks.size());
+    TEST_ASSERT_LESS_THAN(24, totalSize(blocks));
+    assertRoundTrip(samples, 256);
+
+    // 关闭游程编码时每个采样至少一个头
+    auto plain = encode(samples, 256, false);
+    TEST_ASSERT_GREATER_OR_EQUAL(samples.size() * 3, totalSize(plain));
+    assertRoundTrip(samples, 256, false);
+}
+
+void test_large_timestamp_jump_starts_new_block()
+{
+    // RTC未同步时从0计时, 同步后跳到网络时间
+    std::vector<DepthSample> samples = {
+        {0, 100, 200}, {60, 101, 200}, {120, 102, 200},
+        {1700000000, 103, 201}, {1700000060, 104, 201},
+        {5, 105, 201},   // 时间倒退
+        {65, 106, 201},
+    };
+    auto blocks = encode(samples, 256);
+    TEST_ASSERT_EQUAL(3, blocks.size());
+    assertRoundTrip(samples, 256);
+
+    // 二阶差分刚好在范围内时仍在同一块中
+    std::vector<DepthSample> edge = {{0, 0, 0}, {(1u << 30) - 1, 0, 0}, {(1u << 30) - 1, 0, 0}};
+    TEST_ASSERT_EQUAL(1, encode(edge, 256).size());
+    assertRoundTrip(edge, 256);
+    edge[1].timestamp = 1u << 30;
+    edge[2].timestamp = 1u << 30;
+    TEST_ASSERT_EQUAL(2, encode(edge, 256).size());
+    assertRoundTrip(edge, 256);
+}
+
+void test_full_buffer()
+{
+    uint8_t buffer[40];
+    DepthEncoder encoder;
+    encoder.begin(buffer, sizeof(buffer));
+    size_t added = 0;
+    uint32_t ts = 0;
+    while (encoder.add({ts, (int32_t)(added * 1000), 0}))
+    {
+        ts += 60 + added;
+        added++;
+    }
+    TEST_ASSERT_GREATER_THAN(1, added);
+    size_t len = encoder.finish();
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(buffer), len);
+
+    DepthDecoder decoder;
+    TEST_ASSERT_TRUE(decoder.begin(buffer, len));
+    DepthSample s;
+    size_t decoded = 0;
+    while (decoder.next(s))
+    {
+        decoded++;
+    }
+    TEST_ASSERT_EQUAL(added, decoded);
+}
+
+void test_compression_ratio()
+{
+    std::vector<DepthSample> samples = tankTrace();
+    auto blocks = encode(samples, 256);
+    assertRoundTrip(samples, 256);
+
+    // 原始格式: 时间戳4字节 + 液位4字节 + 温度2字节
+    size_t raw = samples.size() * 10;
+    size_t encoded = totalSize(blocks);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "%u samples: raw %u bytes, encoded %u bytes in %u blocks, ratio %.1f",
+             (unsigned)samples.size(), (unsigned)raw, (unsigned)encoded, (unsigned)blocks.size(),
+             (double)raw / encoded);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(raw / 4, encoded);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_run_length_blocks);
+    RUN_TEST(test_large_timestamp_jump_starts_new_block);
+    RUN_TEST(test_full_buffer);
+    RUN_TEST(test_compression_ratio);
+    return UNITY_END();
+}
@@ -0,0 +1,194 @@
+/*
+ * 双调制解调器链路管理测试
+ * 两个模拟模块同时拨号, 覆盖掉线后的默认路由切换及耗时、后台重拨, 以及分流时的合计吞吐量
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "linkmanager.h"
+
+// 模拟的串口速率(字节/秒), 用于把各链路收到的字节数折算为传输时间
+#define LINE_RATE 11520
+
+static SimModule *sims[2];
+static Modem *modems[2];
+
+// 经接口发送一个包, 由所在链路的模拟模块接收
+static void sendPacket(struct netif *netif, size_t len)
+{
+    std::vector<uint8_t> packet(len, 0x45);
+    struct pbuf p = {nullptr, packet.data(), (uint16_t)len, (uint16_t)len};
+    netif->output(netif, &p, nullptr);
+}
+
+// 按 nextNetif() 发送 count 个包, 返回按串口速率折算的合计吞吐量(字节/秒)
+// 两条链路并行传输, 耗时取决于收到数据较多的一条
+static uint32_t measureThroughput(LinkManager &links, int count, size_t len)
+{
+    size_t before[2] = {sims[0]->dataBytes(), sims[1]->dataBytes()};
+    for (int i = 0; i < count; i++)
+    {
+        struct netif *netif = links.nextNetif();
+        TEST_ASSERT_NOT_NULL(netif);
+        sendPacket(netif, len);
+    }
+    size_t bytes[2] = {sims[0]->dataBytes() - before[0], sims[1]->dataBytes() - before[1]};
+    TEST_ASSERT_EQUAL(count * len, bytes[0] + bytes[1]);
+    double seconds = (double)max(bytes[0], bytes[1]) / LINE_RATE;
+    return (bytes[0] + bytes[1]) / seconds;
+}
+
+void setUp()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        sims[i] = new SimModule();
+        modems[i] = new Modem(i == 0 ? "MODEM" : "MODEM2");
+        modems[i]->begin(*sims[i]);
+    }
+    netif_default = nullptr;
+}
+
+void tearDown()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        delete modems[i];
+        delete sims[i];
+    }
+}
+
+void test_begin_dials_both()
+{
+    LinkManager links(*modems[0], *modems[1]);
+    TEST_ASSERT_TRUE(links.begin());
+    TEST_ASSERT_TRUE(sims[0]->dataMode());
+    TEST_ASSERT_TRUE(sims[1]->dataMode());
+    TEST_ASSERT_FALSE(modems[0]->defaultRoute());
+    TEST_ASSERT_FALSE(modems[1]->defaultRoute());
+    TEST_ASSERT_EQUAL_PTR(modems[0], links.active());
+    TEST_ASSERT_EQUAL_PTR(modems[0]->getNetif(), netif_default);
+}
+
+void test_begin_with_secondary_only()
+{
+    sims[0]->setDialResult(false);
+    LinkManager links(*modems[0], *modems[1]);
+    TEST_ASSERT_TRUE(links.begin());
+    TEST_ASSERT_EQUAL_PTR(modems[1], links.active());
+    TEST_ASSERT_EQUAL_PTR(modems[1]->getNetif(), netif_default);
+}
+
+void test_failover()
+{
+    LinkManager links(*modems[0], *modems[1]);
+    links.setRedialInterval(60000);
+    TEST_ASSERT_TRUE(links.begin());
+
+    // 主链路掉线后在同一次 poll() 中切换到备用链路
+    sims[0]->dropCarrier();
+    links.poll();
+    TEST_ASSERT_EQUAL_PTR(modems[1], links.active());
+    TEST_ASSERT_EQUAL_PTR(modems[1]->getNetif(), netif_default);
+    TEST_ASSERT_EQUAL(1, links.failovers());
+    uint32_t latency = links.lastFailoverLatency();
+    TEST_ASSERT_TRUE(latency < 10000);
+    printf("failover latency: %lu us\n", (unsigned long)latency);
+
+    // 两条链路都断开时没有可用的接口
+    sims[1]->dropCarrier();
+    links.poll();
+    TEST_ASSERT_NULL(links.active());
+    TEST_ASSERT_NULL(links.nextNetif());
+    TEST_ASSERT_EQUAL(1, links.failovers());
+}
+
+void test_failover_latency_from_link_loss()
+{
+    LinkManager links(*modems[0], *modems[1]);
+    links.setRedialInterval(60000);
+    TEST_ASSERT_TRUE(links.begin());
+
+    // 耗时从调制解调器检测到断开算起, 包含检测之后到链路管理处理之间的等待
+    sims[0]->dropCarrier();
+    modems[0]->poll();
+    TEST_ASSERT_TRUE(modems[0]->linkLostAt() > 0);
+    delay(20);
+    links.poll();
+    TEST_ASSERT_EQUAL_PTR(modems[1]->getNetif(), netif_default);
+    TEST_ASSERT_GREATER_OR_EQUAL(20000, links.lastFailoverLatency());
+    TEST_ASSERT_LESS_THAN(100000, links.lastFailoverLatency());
+}
+
+void test_redial()
+{
+    LinkManager links(*modems[0], *modems[1]);
+    links.setRedialInterval(0);
+    TEST_ASSERT_TRUE(links.begin());
+
+    // 掉线的链路在后台重拨, 恢复后不抢回默认路由
+    sims[0]->dropCarrier();
+    links.poll();
+    TEST_ASSERT_EQUAL(2, sims[0]->commands("ATD*99#"));
+    TEST_ASSERT_TRUE(sims[0]->dataMode());
+    TEST_ASSERT_FALSE(links.dialing(0));
+    links.poll();
+    TEST_ASSERT_EQUAL_PTR(modems[1], links.active());
+    TEST_ASSERT_NOT_NULL(modems[0]->getNetif());
+
+    // 两条链路都断开后, 先恢复的链路承载默认路由
+    sims[1]->dropCarrier();
+    sims[1]->setDialResult(false);
+    links.poll();
+    TEST_ASSERT_EQUAL_PTR(modems[0], links.active());
+    TEST_ASSERT_EQUAL(2, links.failovers());
+    TEST_ASSERT_EQUAL(2, sims[1]->commands("ATD*99#"));
+    TEST_ASSERT_NULL(modems[1]->getNetif());
+}
+
+void test_redial_interval()
+{
+    sims[1]->setDialResult(false);
+    LinkManager links(*modems[0], *modems[1]);
+    links.setRedialInterval(60000);
+    TEST_ASSERT_TRUE(links.begin());
+    for (int i = 0; i < 10; i++)
+    {
+        links.poll();
+    }
+    TEST_ASSERT_EQUAL(1, sims[1]->commands("ATD*99#"));
+}
+
+void test_aggregate_throughput()
+{
+    LinkManager links(*modems[0], *modems[1]);
+    TEST_ASSERT_TRUE(links.begin());
+
+    // 未启用分流时全部经默认路由发送, 只用到一条链路的速率
+    uint32_t single = measureThroughput(links, 100, 1000);
+    TEST_ASSERT_EQUAL(LINE_RATE, single);
+
+    // 分流时两条链路各承担一半, 合计吞吐量接近两倍
+    links.setAggregate(true);
+    uint32_t combined = measureThroughput(links, 100, 1000);
+    TEST_ASSERT_EQUAL(2 * LINE_RATE, combined);
+    printf("throughput: single %lu B/s, combined %lu B/s\n", (unsigned long)single, (unsigned long)combined);
+
+    // 一条链路断开后分流自动只使用在线链路
+    sims[1]->dropCarrier();
+    links.poll();
+    TEST_ASSERT_EQUAL(LINE_RATE, measureThroughput(links, 10, 1000));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_dials_both);
+    RUN_TEST(test_begin_with_secondary_only);
+    RUN_TEST(test_failover);
+    RUN_TEST(test_failover_latency_from_link_loss);
+    RUN_TEST(test_redial);
+    RUN_TEST(test_redial_interval);
+    RUN_TEST(test_aggregate_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+/*
+ * PPP抓包测试
+ * 以HDLC帧和伪造的网络接口输出喂入大小混合的包, 让环形缓冲区多次回绕,
+ * 每次写入后导出pcap并检查包序列连续、以最新的包结束
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "pppcapture.h"
+
+// 把导出的十六进制文本还原为pcap文件
+class HexSink : public Print
+{
+public:
+    size_t write(uint8_t c) override
+    {
+        if (!isxdigit(c))
+        {
+            return 1;
+        }
+        uint8_t value = isdigit(c) ? c - '0' : toupper(c) - 'A' + 10;
+        if (_high)
+        {
+            data.push_back((_nibble << 4) | value);
+        }
+        _nibble = value;
+        _high = !_high;
+        return 1;
+    }
+    using Print::write;
+
+    std::vector<uint8_t> data;
+
+private:
+    uint8_t _nibble = 0;
+    bool _high = false;
+};
+
+static uint32_t readLE32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t fcs16(const uint8_t *data, size_t len)
+{
+    uint16_t fcs = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        fcs ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            fcs = (fcs & 1) ? (fcs >> 1) ^ 0x8408 : fcs >> 1;
+        }
+    }
+    return fcs;
+}
+
+// 长度为len的IPv4包, 第4~7字节为序号
+static std::vector<uint8_t> makePacket(uint32_t seq, size_t len)
+{
+    std::vector<uint8_t> packet(len);
+    for (size_t i = 0; i < len; i++)
+    {
+        packet[i] = (uint8_t)(seq + i);
+    }
+    packet[0] = 0x45;
+    memcpy(&packet[4], &seq, sizeof(seq));
+    return packet;
+}
+
+// 按RFC 1662封装为HDLC帧, compress 为真时省略地址/控制字段并压缩协议字段
+static std::vector<uint8_t> makeFrame(const std::vector<uint8_t> &packet, bool compress = false, bool badFcs = false)
+{
+    std::vector<uint8_t> raw;
+    if (!compress)
+    {
+        raw = {0xFF, 0x03, 0x00};
+    }
+    raw.push_back(0x21);
+    raw.insert(raw.end(), packet.begin(), packet.end());
+    uint16_t fcs = ~fcs16(raw.data(), raw.size());
+    if (badFcs)
+    {
+        fcs ^= 1;
+    }
+    raw.push_back(fcs & 0xFF);
+    raw.push_back(fcs >> 8);
+
+    std::vector<uint8_t> frame = {0x7E};
+    for (uint8_t c : raw)
+    {
+        if (c == 0x7E || c == 0x7D || c < 0x20)
+        {
+            frame.push_back(0x7D);
+            frame.push_back(c ^ 0x20);
+        }
+        else
+        {
+            frame.push_back(c);
+        }
+    }
+    frame.push_back(0x7E);
+    return frame;
+}
+
+static err_t nullOutput(struct netif *, struct pbuf *, const ip4_addr_t *)
+{
+    return ERR_OK;
+}
+
+// 经伪造的PPP接口发送一个包
+static void sendPacket(struct netif &netif, std::vector<uint8_t> &packet)
+{
+    struct pbuf p = {nullptr, packet.data(), (uint16_t)packet.size(), (uint16_t)packet.size()};
+    netif.output(&netif, &p, nullptr);
+}
+
+// 导出并逐个检查包, 返回包的序号
+static std::vector<uint32_t> dumpSequence(PppCapture &capture, uint16_t snapLen)
+{
+    HexSink pcap;
+    size_t total = capture.dump(pcap);
+    TEST_ASSERT_EQUAL(total, pcap.data.size());
+    TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4, readLE32(pcap.data.data()));
+
+    std::vector<uint32_t> seqs;
+    size_t pos = 24;
+    while (pos < pcap.data.size())
+    {
+        TEST_ASSERT_TRUE(pos + 16 <= pcap.data.size());
+        uint32_t capLen = readLE32(&pcap.data[pos + 8]);
+        uint32_t origLen = readLE32(&pcap.data[pos + 12]);
+        TEST_ASSERT_EQUAL(min(origLen, (uint32_t)snapLen), capLen);
+        TEST_ASSERT_TRUE(pos + 16 + capLen <= pcap.data.size());
+        std::vector<uint8_t> packet(&pcap.data[pos + 16], &pcap.data[pos + 16 + capLen]);
+        uint32_t seq = readLE32(&packet[4]);
+        std::vector<uint8_t> expected = makePacket(seq, origLen);
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), packet.data(), capLen);
+        seqs.push_back(seq);
+        pos += 16 + capLen;
+    }
+    TEST_ASSERT_EQUAL(capture.packets(), seqs.size());
+    return seqs;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_frames_decoded()
+{
+    static uint8_t buffer[4096];
+    PppCapture capture;
+    capture.begin(buffer, sizeof(buffer));
+    capture.start();
+
+    std::vector<uint8_t> stream;
+    auto append = [&](const std::vector<uint8_t> &frame) { stream.insert(stream.end(), frame.begin(), frame.end()); };
+    append(makeFrame(makePacket(1, 60)));
+    append(makeFrame(makePacket(2, 60), true));
+    append(makeFrame(makePacket(3, 60), false, true));  // FCS错误, 丢弃
+    append(makeFrame(makePacket(4, 60)));
+    // 分多次输入, 帧跨越两次调用
+    capture.input(stream.data(), 7);
+    capture.input(stream.data() + 7, stream.size() - 7);
+
+    std::vector<uint32_t> seqs = dumpSequence(capture, 96);
+    TEST_ASSERT_EQUAL(3, seqs.size());
+    TEST_ASSERT_EQUAL(1, seqs[0]);
+    TEST_ASSERT_EQUAL(2, seqs[1]);
+    TEST_ASSERT_EQUAL(4, seqs[2]);
+    TEST_ASSERT_EQUAL(3, capture.received());
+    TEST_ASSERT_EQUAL(0, capture.sent());
+}
+
+// 大小混合的包多次回绕环形缓冲区
+static void wrapMany(size_t size, uint16_t snapLen)
+{
+    static uint8_t buffer[2048];
+    TEST_ASSERT_TRUE(size <= sizeof(buffer));
+    PppCapture capture;
+    capture.begin(buffer, size);
+    TEST_ASSERT_EQUAL(snapLen, capture.setSnapLength(snapLen));
+    struct netif netif = {nullOutput};
+    capture.attach(&netif);
+    capture.start();
+
+    srand(1);
+    uint32_t lastSeq = 0;
+    for (uint32_t seq = 1; seq <= 3000; seq++)
+    {
+        static const size_t lengths[] = {40, 1500, 52, 576};
+        std::vector<uint8_t> packet = makePacket(seq, lengths[rand() % 4]);
+        if (rand() % 2)
+        {
+            sendPacket(netif, packet);
+        }
+        else
+        {
+            std::vector<uint8_t> frame = makeFrame(packet);
+            capture.input(frame.data(), frame.size());
+        }
+
+        std::vector<uint32_t> seqs = dumpSequence(capture, snapLen);
+        TEST_ASSERT_TRUE(seqs.size() > 0);
+        TEST_ASSERT_EQUAL(seq, seqs.back());
+        for (size_t i = 1; i < seqs.size(); i++)
+        {
+            TEST_ASSERT_EQUAL(seqs[i - 1] + 1, seqs[i]);
+        }
+        lastSeq = seqs.back();
+    }
+    TEST_ASSERT_EQUAL(3000, lastSeq);
+    TEST_ASSERT_EQUAL(3000, capture.captured());
+    TEST_ASSERT_EQUAL(capture.captured(), capture.overwritten() + capture.packets());
+    TEST_ASSERT_EQUAL(capture.captured(), capture.received() + capture.sent());
+    capture.detach();
+    TEST_ASSERT_TRUE(netif.output == nullOutput);
+}
+
+void test_wrap_small_snap()
+{
+    wrapMany(1000, 96);
+}
+
+void test_wrap_large_snap()
+{
+    // 包长度接近缓冲区大小, 每次写入都要覆盖多个包
+    wrapMany(1000, 600);
+    wrapMany(2048, 1500);
+}
+
+void test_snap_length_clamped()
+{
+    static uint8_t buffer[256];
+    PppCapture capture;
+    capture.begin(buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL(256 - 12, capture.setSnapLength(1500));
+    capture.start();
+
+    std::vector<uint8_t> frame = makeFrame(makePacket(7, 1500));
+    capture.input(frame.data(), frame.size());
+    capture.input(frame.data(), frame.size());
+    std::vector<uint32_t> seqs = dumpSequence(capture, 256 - 12);
+    TEST_ASSERT_EQUAL(1, seqs.size());
+    TEST_ASSERT_EQUAL(1, capture.overwritten());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_decoded);
+    RUN_TEST(test_wrap_small_snap);
+    RUN_TEST(test_wrap_large_snap);
+    RUN_TEST(test_snap_length_clamped);
+    return UNITY_END();
+}
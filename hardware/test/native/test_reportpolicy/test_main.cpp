@@ -0,0 +1,166 @@
+/*
+ * 液位上报策略回放测试
+ * 按策略给出的采样间隔回放合成的24小时液位记录, 与固定间隔上报比较发送次数和数据量,
+ * 并检查加注/抽取的开始和结束是否及时发送
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "reportpolicy.h"
+
+#define DAY (24 * 3600)
+#define FILL_START (6 * 3600)
+#define FILL_END (FILL_START + 20 * 60)
+#define DRAIN_START (14 * 3600)
+#define DRAIN_END (DRAIN_START + 20 * 60)
+
+// 合成液位: 1米静止(噪声±1毫米), 6点加注20分钟(50毫米/分钟), 14点抽取20分钟(30毫米/分钟)
+static int32_t tankDepth(uint32_t t, bool withEvents = true)
+{
+    uint32_t seed = t * 2654435761u;
+    int32_t depth = 10000 + (int32_t)((seed >> 16) % 21) - 10;
+    if (!withEvents)
+    {
+        return depth;
+    }
+    if (t >= FILL_START)
+    {
+        depth += 500 * (int32_t)(t < FILL_END ? t - FILL_START : FILL_END - FILL_START) / 60;
+    }
+    if (t >= DRAIN_START)
+    {
+        depth -= 300 * (int32_t)(t < DRAIN_END ? t - DRAIN_START : DRAIN_END - DRAIN_START) / 60;
+    }
+    return depth;
+}
+
+struct Replay
+{
+    std::vector<uint32_t> sends;       // 发送时间
+    std::vector<uint32_t> intervals;   // 策略给出的采样间隔
+    size_t bytes;                      // 发送的数据块总长度
+};
+
+// 按固件的用法回放: 记录的采样写入数据块, 需要发送时结束当前块
+// @param fixed 固定间隔(秒), 为0时使用策略
+static Replay replay(uint32_t fixed, bool withEvents = true)
+{
+    Replay result = {{}, {}, 0};
+    ReportPolicy policy;
+    policy.begin();
+    uint8_t block[256];
+    DepthEncoder encoder;
+    encoder.begin(block, sizeof(block));
+
+    uint32_t t = 0;
+    while (t < DAY)
+    {
+        DepthSample sample = {t, tankDepth(t, withEvents), 250};
+        ReportAction action = fixed ? REPORT_SEND : policy.add(sample);
+        if (action != REPORT_SKIP)
+        {
+            if (!encoder.add(sample))
+            {
+                result.bytes += encoder.finish();
+                encoder.begin(block, sizeof(block));
+                TEST_ASSERT_TRUE(encoder.add(sample));
+            }
+        }
+        if (action == REPORT_SEND)
+        {
+            result.bytes += encoder.finish();
+            encoder.begin(block, sizeof(block));
+            result.sends.push_back(t);
+        }
+
+        uint32_t interval = fixed ? fixed : policy.nextInterval();
+        result.intervals.push_back(interval);
+        t += interval;
+    }
+    return result;
+}
+
+// 在 [from, from + within) 内是否有发送
+static bool sentWithin(const Replay &r, uint32_t from, uint32_t within)
+{
+    for (uint32_t t : r.sends)
+    {
+        if (t >= from && t < from + within)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_fewer_sends_than_fixed_rate()
+{
+    Replay fixed = replay(60);
+    Replay policy = replay(0);
+    printf("固定60秒: %u 次发送, %u 字节; 上报策略: %u 次发送, %u 字节\n",
+           (unsigned)fixed.sends.size(), (unsigned)fixed.bytes,
+           (unsigned)policy.sends.size(), (unsigned)policy.bytes);
+
+    TEST_ASSERT_EQUAL(1440, fixed.sends.size());
+    TEST_ASSERT_LESS_THAN(fixed.sends.size() / 50, policy.sends.size());
+    TEST_ASSERT_LESS_THAN(fixed.bytes / 10, policy.bytes);
+}
+
+void test_events_sent_promptly()
+{
+    Replay r = replay(0);
+    // 静止时采样间隔最长2分钟, 速率估计需要两个采样
+    TEST_ASSERT_TRUE(sentWithin(r, FILL_START, 180));
+    TEST_ASSERT_TRUE(sentWithin(r, FILL_END, 60));
+    TEST_ASSERT_TRUE(sentWithin(r, DRAIN_START, 180));
+    TEST_ASSERT_TRUE(sentWithin(r, DRAIN_END, 60));
+}
+
+void test_interval_follows_activity()
+{
+    ReportConfig config = ReportConfig::defaults();
+    Replay r = replay(0);
+    bool reachedMax = false;
+    for (uint32_t interval : r.intervals)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL(config.minInterval, interval);
+        TEST_ASSERT_LESS_OR_EQUAL(config.maxInterval, interval);
+        reachedMax |= interval == config.maxInterval;
+    }
+    TEST_ASSERT_TRUE(reachedMax);
+
+    // 加注期间按最短间隔采样
+    ReportPolicy policy;
+    policy.begin();
+    for (uint32_t t = FILL_START - 600; t < FILL_START + 300; t += policy.nextInterval())
+    {
+        policy.add({t, tankDepth(t), 250});
+    }
+    TEST_ASSERT_TRUE(policy.moving());
+    TEST_ASSERT_EQUAL_UINT32(config.minInterval, policy.nextInterval());
+}
+
+void test_static_level_heartbeat()
+{
+    // 液位一直在死区内时只有首个采样和心跳
+    ReportConfig config = ReportConfig::defaults();
+    Replay r = replay(0, false);
+    TEST_ASSERT_EQUAL(DAY / config.heartbeat, r.sends.size());
+    for (size_t i = 1; i < r.sends.size(); i++)
+    {
+        TEST_ASSERT_LESS_OR_EQUAL(config.heartbeat + config.maxInterval, r.sends[i] - r.sends[i - 1]);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fewer_sends_than_fixed_rate);
+    RUN_TEST(test_events_sent_promptly);
+    RUN_TEST(test_interval_follows_activity);
+    RUN_TEST(test_static_level_heartbeat);
+    return UNITY_END();
+}
@@ -0,0 +1,141 @@
+/*
+ * 串口透明桥接测试
+ * 按时间安排两侧串口的输入, 覆盖 ~~~ 退出序列的1秒静默要求和 AT+IPR 波特率跟随
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include "serialbridge.h"
+
+static HardwareSerial *host;
+static HardwareSerial *modem;
+
+// 静默时间之后发送退出序列, 再静默一段时间, 桥接应在此之后返回
+#define ESCAPE_AT 1200
+#define ESCAPE_QUIET 1000
+
+static void feedEscape(uint32_t at)
+{
+    host->feed("~~~", at);
+}
+
+// 运行桥接并返回耗时(毫秒)
+static uint32_t runBridge()
+{
+    SerialBridge bridge(*host, *modem);
+    uint32_t start = millis();
+    bridge.run();
+    return millis() - start;
+}
+
+void setUp()
+{
+    host = new HardwareSerial();
+    modem = new HardwareSerial();
+    host->record();
+    modem->record();
+}
+
+void tearDown()
+{
+    delete host;
+    delete modem;
+}
+
+void test_forward_and_escape()
+{
+    host->feed("ATI\r", 10);
+    modem->feed("\r\nSIM7600\r\nOK\r\n", 50);
+    feedEscape(ESCAPE_AT);
+
+    uint32_t elapsed = runBridge();
+    // 退出序列之后还需静默1秒
+    TEST_ASSERT_GREATER_OR_EQUAL(ESCAPE_AT + ESCAPE_QUIET, elapsed);
+    TEST_ASSERT_EQUAL_STRING("ATI\r", modem->output.c_str());
+    TEST_ASSERT_EQUAL_STRING("\r\nSIM7600\r\nOK\r\n", host->output.c_str());
+}
+
+void test_escape_needs_guard_before()
+{
+    // 紧跟在数据之后的 ~~~ 照常转发
+    host->feed("AT~~~", 10);
+    feedEscape(ESCAPE_AT);
+
+    runBridge();
+    TEST_ASSERT_EQUAL_STRING("AT~~~", modem->output.c_str());
+}
+
+void test_escape_needs_guard_after()
+{
+    // ~~~ 之后1秒内又有数据时不是退出序列, 全部转发
+    host->feed("~~~", ESCAPE_AT);
+    host->feed("x", ESCAPE_AT + 300);
+    feedEscape(ESCAPE_AT + 300 + ESCAPE_AT);
+
+    uint32_t elapsed = runBridge();
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * ESCAPE_AT + 300 + ESCAPE_QUIET, elapsed);
+    TEST_ASSERT_EQUAL_STRING("~~~x", modem->output.c_str());
+}
+
+void test_single_tilde_forwarded()
+{
+    // 静默后单独的 '~' (如HDLC帧标志) 在静默1秒后照常转发
+    host->feed("~", ESCAPE_AT);
+    feedEscape(ESCAPE_AT + ESCAPE_AT + 200);
+
+    runBridge();
+    TEST_ASSERT_EQUAL_STRING("~", modem->output.c_str());
+}
+
+void test_baud_follows_ipr()
+{
+    // 指令和应答都被拆成两次读取
+    host->feed("AT+I", 10);
+    host->feed("PR=921600\r", 60);
+    modem->feed("\r\nO", 120);
+    modem->feed("K\r\n", 170);
+    feedEscape(ESCAPE_AT);
+
+    runBridge();
+    TEST_ASSERT_EQUAL(921600, host->baudRate());
+    TEST_ASSERT_EQUAL(921600, modem->baudRate());
+    TEST_ASSERT_EQUAL_STRING("\r\nOK\r\n", host->output.c_str());
+}
+
+void test_baud_after_other_bytes()
+{
+    // 同一次读取中前面还有其他指令, 以及与其他指令合并在一行
+    host->feed("AT\r\nat+csq;+ipr=57600\r", 10);
+    modem->feed("\r\nOK\r\n\r\n+CSQ: 20,0\r\n\r\nOK\r\n", 100);
+    feedEscape(ESCAPE_AT);
+
+    runBridge();
+    TEST_ASSERT_EQUAL(57600, host->baudRate());
+    TEST_ASSERT_EQUAL(57600, modem->baudRate());
+}
+
+void test_baud_unchanged_on_error()
+{
+    host->feed("AT+IPR=9600\r", 10);
+    modem->feed("\r\nERROR\r\n", 100);
+    // 之后的 OK 属于其他指令
+    host->feed("AT\r", 200);
+    modem->feed("\r\nOK\r\n", 300);
+    feedEscape(ESCAPE_AT);
+
+    runBridge();
+    TEST_ASSERT_EQUAL(115200, host->baudRate());
+    TEST_ASSERT_EQUAL(115200, modem->baudRate());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_forward_and_escape);
+    RUN_TEST(test_escape_needs_guard_before);
+    RUN_TEST(test_escape_needs_guard_after);
+    RUN_TEST(test_single_tilde_forwarded);
+    RUN_TEST(test_baud_follows_ipr);
+    RUN_TEST(test_baud_after_other_bytes);
+    RUN_TEST(test_baud_unchanged_on_error);
+    return UNITY_END();
+}
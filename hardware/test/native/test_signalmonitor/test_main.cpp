@@ -0,0 +1,230 @@
+/*
+ * 信号质量采样测试
+ * 用模拟模块应答 AT+CSQ/AT+CESQ, 覆盖数值换算、未知值、平均判断、采样间隔和推迟发送
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include "signalmonitor.h"
+
+static SimModule *sim;
+static Modem *modem;
+
+// CSQ 0~31 对应 -113~-51dBm
+static String csq(int rssi, int ber = 0)
+{
+    return "+CSQ: " + String(rssi) + "," + String(ber);
+}
+
+// RSRQ/RSRP 取值, 其余字段为未知
+static String cesq(int rsrq, int rsrp)
+{
+    return "+CESQ: 99,99,255,255," + String(rsrq) + "," + String(rsrp);
+}
+
+static SignalSample latest(const SignalMonitor &monitor)
+{
+    SignalSample sample = {};
+    TEST_ASSERT_TRUE(monitor.latest(sample));
+    return sample;
+}
+
+void setUp()
+{
+    sim = new SimModule();
+    modem = new Modem();
+    modem->begin(*sim);
+}
+
+void tearDown()
+{
+    delete modem;
+    delete sim;
+}
+
+void test_csq_conversion()
+{
+    SignalMonitor monitor(*modem);
+    sim->reply("AT+CESQ", "ERROR");
+
+    sim->reply("AT+CSQ", csq(0, 3));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(-113, latest(monitor).rssi);
+    TEST_ASSERT_EQUAL(3, latest(monitor).ber);
+
+    sim->reply("AT+CSQ", csq(31));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(-51, latest(monitor).rssi);
+
+    // 99: 未知
+    sim->reply("AT+CSQ", csq(99, 99));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(SIGNAL_UNKNOWN, latest(monitor).rssi);
+    TEST_ASSERT_EQUAL(99, latest(monitor).ber);
+    TEST_ASSERT_EQUAL(SIGNAL_UNKNOWN, latest(monitor).rsrp);
+}
+
+void test_cesq_conversion()
+{
+    SignalMonitor monitor(*modem);
+    sim->reply("AT+CSQ", csq(20));
+
+    sim->reply("AT+CESQ", cesq(34, 97));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(-3, latest(monitor).rsrq);
+    TEST_ASSERT_EQUAL(-44, latest(monitor).rsrp);
+
+    sim->reply("AT+CESQ", cesq(0, 0));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(-20, latest(monitor).rsrq);
+    TEST_ASSERT_EQUAL(-141, latest(monitor).rsrp);
+
+    // 255: 未知, RSSI照常换算
+    sim->reply("AT+CESQ", cesq(255, 255));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(SIGNAL_UNKNOWN, latest(monitor).rsrq);
+    TEST_ASSERT_EQUAL(SIGNAL_UNKNOWN, latest(monitor).rsrp);
+    TEST_ASSERT_EQUAL(-73, latest(monitor).rssi);
+}
+
+void test_cesq_unsupported()
+{
+    // 模块不支持 AT+CESQ 时只查询一次
+    SignalMonitor monitor(*modem);
+    sim->reply("AT+CSQ", csq(20));
+    sim->reply("AT+CESQ", "ERROR");
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(2, sim->commands("AT+CSQ"));
+    TEST_ASSERT_EQUAL(1, sim->commands("AT+CESQ"));
+}
+
+void test_average_of_recent_samples()
+{
+    SignalMonitor monitor(*modem);
+    monitor.setThreshold(-95, -110);
+    sim->reply("AT+CESQ", "ERROR");
+
+    // 没有采样时不推迟
+    TEST_ASSERT_TRUE(monitor.isGood());
+
+    // -89, -101, -101: 平均 -97 低于门限
+    sim->reply("AT+CSQ", csq(12));
+    monitor.sample(true);
+    sim->reply("AT+CSQ", csq(6));
+    monitor.sample(true);
+    monitor.sample(true);
+    TEST_ASSERT_FALSE(monitor.isGood());
+
+    // 只平均最近3次: -101, -101, -81 平均 -94
+    sim->reply("AT+CSQ", csq(16));
+    monitor.sample(true);
+    TEST_ASSERT_TRUE(monitor.isGood());
+
+    // 未知值不参与平均
+    sim->reply("AT+CSQ", csq(99));
+    monitor.sample(true);
+    monitor.sample(true);
+    TEST_ASSERT_TRUE(monitor.isGood());
+    monitor.sample(true);
+    TEST_ASSERT_TRUE(monitor.isGood());
+
+    SignalSample samples[8];
+    TEST_ASSERT_EQUAL(7, monitor.history(samples, 8));
+    TEST_ASSERT_EQUAL(-89, samples[0].rssi);
+    TEST_ASSERT_EQUAL(2, monitor.history(samples, 2));
+    TEST_ASSERT_EQUAL(SIGNAL_UNKNOWN, samples[1].rssi);
+}
+
+void test_rsrp_preferred()
+{
+    // RSSI良好但RSRP低于门限时判断为较差
+    SignalMonitor monitor(*modem);
+    monitor.setThreshold(-95, -110);
+    sim->reply("AT+CSQ", csq(25));
+    sim->reply("AT+CESQ", cesq(20, 25));
+    monitor.sample(true);
+    TEST_ASSERT_EQUAL(-116, latest(monitor).rsrp);
+    TEST_ASSERT_FALSE(monitor.isGood());
+
+    sim->reply("AT+CESQ", cesq(20, 40));
+    monitor.sample(true);
+    monitor.sample(true);
+    // 平均 (-116 - 101 - 101) / 3 = -106
+    TEST_ASSERT_TRUE(monitor.isGood());
+}
+
+void test_sample_interval()
+{
+    SignalMonitor monitor(*modem);
+    monitor.setInterval(60000);
+    sim->reply("AT+CSQ", csq(20));
+    sim->reply("AT+CESQ", "ERROR");
+
+    TEST_ASSERT_TRUE(monitor.sample());
+    TEST_ASSERT_FALSE(monitor.sample());
+    TEST_ASSERT_EQUAL(1, sim->commands("AT+CSQ"));
+    TEST_ASSERT_TRUE(monitor.sample(true));
+
+    // 查询失败也等待一个间隔
+    SignalMonitor failing(*modem);
+    failing.setInterval(60000);
+    sim->reply("AT+CSQ", "ERROR");
+    TEST_ASSERT_FALSE(failing.sample());
+    TEST_ASSERT_FALSE(failing.sample());
+    TEST_ASSERT_EQUAL(3, sim->commands("AT+CSQ"));
+    SignalSample sample;
+    TEST_ASSERT_FALSE(failing.latest(sample));
+}
+
+void test_no_sample_while_connected()
+{
+    SignalMonitor monitor(*modem);
+    TEST_ASSERT_TRUE(modem->connect("CMNET"));
+    TEST_ASSERT_FALSE(monitor.sample(true));
+    TEST_ASSERT_EQUAL(0, sim->commands("AT+CSQ"));
+}
+
+void test_should_defer()
+{
+    SignalMonitor monitor(*modem);
+    monitor.setInterval(0);
+    monitor.setMaxDelay(50);
+    sim->reply("AT+CSQ", csq(5));
+    sim->reply("AT+CESQ", "ERROR");
+
+    uint32_t queuedAt = millis();
+    TEST_ASSERT_TRUE(monitor.shouldDefer(queuedAt));
+    TEST_ASSERT_FALSE(monitor.shouldDefer(queuedAt, true));
+
+    // 信号好转后立即发送
+    sim->reply("AT+CSQ", csq(25));
+    for (int i = 0; i < 3; i++)
+    {
+        monitor.sample(true);
+    }
+    TEST_ASSERT_FALSE(monitor.shouldDefer(queuedAt));
+
+    // 超过最长推迟时间后不再推迟
+    sim->reply("AT+CSQ", csq(5));
+    for (int i = 0; i < 3; i++)
+    {
+        monitor.sample(true);
+    }
+    TEST_ASSERT_TRUE(monitor.shouldDefer(queuedAt));
+    delay(60);
+    TEST_ASSERT_FALSE(monitor.shouldDefer(queuedAt));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_csq_conversion);
+    RUN_TEST(test_cesq_conversion);
+    RUN_TEST(test_cesq_unsupported);
+    RUN_TEST(test_average_of_recent_samples);
+    RUN_TEST(test_rsrp_preferred);
+    RUN_TEST(test_sample_interval);
+    RUN_TEST(test_no_sample_while_connected);
+    RUN_TEST(test_should_defer);
+    return UNITY_END();
+}
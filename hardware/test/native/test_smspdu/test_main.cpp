@@ -0,0 +1,75 @@
+/*
+ * 短信PDU编码测试
+ * 与公开的参考PDU比较, 覆盖号码格式、7位打包、字符替换和超长截断
+ */
+#include <unity.h>
+#include "smspdu.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_reference_pdu()
+{
+    // 参考: "hellohello" 发往 +46708251358, 用户数据为 E8329BFD4697D9EC37
+    String pdu;
+    size_t len = SmsPdu::encode("+46708251358", "hellohello", pdu);
+    TEST_ASSERT_EQUAL_STRING("0001000B916407281553F800000AE8329BFD4697D9EC37", pdu.c_str());
+    TEST_ASSERT_EQUAL(pdu.length() / 2 - 1, len);
+    TEST_ASSERT_EQUAL(22, len);
+}
+
+void test_national_number()
+{
+    // 国内号码类型为0x81, 奇数位时末尾补F
+    String pdu;
+    TEST_ASSERT_NOT_EQUAL(0, SmsPdu::encode("13800138000", "A", pdu));
+    TEST_ASSERT_EQUAL_STRING("0001000B813108108300F000000141", pdu.c_str());
+
+    TEST_ASSERT_NOT_EQUAL(0, SmsPdu::encode("1380013800", "A", pdu));
+    TEST_ASSERT_EQUAL_STRING("0001000A81310810830000000141", pdu.c_str());
+}
+
+void test_invalid_number()
+{
+    String pdu;
+    TEST_ASSERT_EQUAL(0, SmsPdu::encode("", "x", pdu));
+    TEST_ASSERT_EQUAL(0, SmsPdu::encode("+", "x", pdu));
+    TEST_ASSERT_EQUAL(0, SmsPdu::encode("1380A138000", "x", pdu));
+    TEST_ASSERT_EQUAL(0, SmsPdu::encode("123456789012345678901", "x", pdu));
+}
+
+void test_septet_packing()
+{
+    // 8个字符正好打包为7字节
+    String pdu;
+    SmsPdu::encode("+1", "ABCDEFGH", pdu);
+    TEST_ASSERT_EQUAL_STRING("0001000191F100000841E19058341E91", pdu.c_str());
+
+    // '@'映射为0x00, 需要扩展表的'['替换为'?'
+    SmsPdu::encode("+1", "@[A", pdu);
+    TEST_ASSERT_EQUAL_STRING("0001000191F1000003805F10", pdu.c_str());
+}
+
+void test_truncated_to_single_message()
+{
+    char text[201];
+    memset(text, 'x', 200);
+    text[200] = '\0';
+
+    String pdu;
+    size_t len = SmsPdu::encode("+1", text, pdu);
+    // 头部7字节 + 号码1字节 + 160个字符打包为140字节
+    TEST_ASSERT_EQUAL(7 + 1 + 140, len);
+    TEST_ASSERT_EQUAL_STRING("A0", pdu.substr(16, 2).c_str());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reference_pdu);
+    RUN_TEST(test_national_number);
+    RUN_TEST(test_invalid_number);
+    RUN_TEST(test_septet_packing);
+    RUN_TEST(test_truncated_to_single_message);
+    return UNITY_END();
+}
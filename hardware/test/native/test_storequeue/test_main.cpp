@@ -0,0 +1,313 @@
+/*
+ * 存储转发队列测试
+ * 以主机目录模拟闪存, 覆盖CRC记录格式、读取/回退/提交、掉电恢复、段压缩和批量读取
+ */
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include "storequeue.h"
+
+static const std::string root = (std::filesystem::temp_directory_path() / "storequeue_test").string();
+static fs::FS hostFs(root);
+
+// 第i条测试记录: 长度和内容都随i变化
+static size_t makeRecord(uint32_t i, uint8_t *out)
+{
+    size_t len = 8 + i % 40;
+    for (size_t j = 0; j < len; j++)
+    {
+        out[j] = (uint8_t)(i * 31 + j);
+    }
+    return len;
+}
+
+static void appendRecords(StoreQueue &queue, uint32_t from, uint32_t to)
+{
+    uint8_t data[64];
+    for (uint32_t i = from; i < to; i++)
+    {
+        TEST_ASSERT_TRUE(queue.append(data, makeRecord(i, data)));
+    }
+}
+
+// 依次读出记录并检查内容, 返回读出的条数
+static uint32_t expectRecords(StoreQueue &queue, uint32_t from, uint32_t to)
+{
+    uint8_t expected[64], out[StoreQueue::MAX_RECORD];
+    uint32_t i = from;
+    size_t len;
+    while (i < to && (len = queue.read(out, sizeof(out))) > 0)
+    {
+        TEST_ASSERT_EQUAL(makeRecord(i, expected), len);
+        TEST_ASSERT_EQUAL_MEMORY(expected, out, len);
+        i++;
+    }
+    return i - from;
+}
+
+static size_t segmentCount()
+{
+    size_t n = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(root + "/queue"))
+    {
+        n += entry.path().extension() == ".seg";
+    }
+    return n;
+}
+
+void setUp()
+{
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+}
+
+void tearDown()
+{
+    std::filesystem::remove_all(root);
+}
+
+void test_append_and_read()
+{
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin());
+    TEST_ASSERT_TRUE(queue.empty());
+    appendRecords(queue, 0, 100);
+    TEST_ASSERT_FALSE(queue.empty());
+    TEST_ASSERT_EQUAL(100, expectRecords(queue, 0, 100));
+
+    uint8_t out[StoreQueue::MAX_RECORD];
+    TEST_ASSERT_EQUAL(0, queue.read(out, sizeof(out)));
+    TEST_ASSERT_TRUE(queue.commit());
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_rewind_and_commit()
+{
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin());
+    appendRecords(queue, 0, 10);
+
+    // 上传失败: 回到上次提交的位置
+    TEST_ASSERT_EQUAL(4, expectRecords(queue, 0, 4));
+    queue.rewind();
+    TEST_ASSERT_EQUAL(4, expectRecords(queue, 0, 4));
+    TEST_ASSERT_TRUE(queue.commit());
+
+    // 读取但未提交的记录在重启后重新读出
+    TEST_ASSERT_EQUAL(3, expectRecords(queue, 4, 7));
+    StoreQueue reopened(hostFs);
+    TEST_ASSERT_TRUE(reopened.begin());
+    TEST_ASSERT_EQUAL(6, expectRecords(reopened, 4, 10));
+}
+
+void test_unflushed_page_lost_on_power_cut()
+{
+    {
+        StoreQueue queue(hostFs);
+        TEST_ASSERT_TRUE(queue.begin());
+        appendRecords(queue, 0, 5);
+        TEST_ASSERT_TRUE(queue.flush());
+        appendRecords(queue, 5, 7);   // 仍在页缓冲中, 未写入闪存
+    }
+
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin());
+    TEST_ASSERT_EQUAL(5, expectRecords(queue, 0, 10));
+}
+
+void test_corrupt_tail_skipped()
+{
+    {
+        StoreQueue queue(hostFs);
+        TEST_ASSERT_TRUE(queue.begin());
+        appendRecords(queue, 0, 5);
+        TEST_ASSERT_TRUE(queue.flush());
+    }
+
+    // 模拟写入过程中掉电: 段尾部只有半条记录, 以及数据损坏的记录
+    std::string segment;
+    for (const auto &entry : std::filesystem::directory_iterator(root + "/queue"))
+    {
+        if (entry.path().extension() == ".seg")
+        {
+            segment = entry.path().string();
+        }
+    }
+    FILE *f = fopen(segment.c_str(), "ab");
+    const uint8_t torn[] = {0xA5, 0x10, 0x00, 0x12, 0x34};
+    fwrite(torn, 1, sizeof(torn), f);
+    fclose(f);
+
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin());
+    appendRecords(queue, 5, 8);
+    TEST_ASSERT_EQUAL(8, expectRecords(queue, 0, 8));
+
+    // 内容与CRC不符的记录被丢弃
+    uint8_t data[64];
+    size_t len = makeRecord(8, data);
+    TEST_ASSERT_TRUE(queue.append(data, len));
+    TEST_ASSERT_TRUE(queue.flush());
+    TEST_ASSERT_TRUE(queue.commit());
+    StoreQueue reopened(hostFs);
+    TEST_ASSERT_TRUE(reopened.begin());
+    std::string last;
+    for (const auto &entry : std::filesystem::directory_iterator(root + "/queue"))
+    {
+        if (entry.path().extension() == ".seg" && entry.path().string() > last)
+        {
+            last = entry.path().string();
+        }
+    }
+    f = fopen(last.c_str(), "r+b");
+    fseek(f, -1, SEEK_END);
+    fputc(data[len - 1] ^ 0xFF, f);
+    fclose(f);
+    StoreQueue damaged(hostFs);
+    TEST_ASSERT_TRUE(damaged.begin());
+    uint8_t out[StoreQueue::MAX_RECORD];
+    TEST_ASSERT_EQUAL(0, damaged.read(out, sizeof(out)));
+}
+
+void test_compaction_removes_consumed_segments()
+{
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin(1024, 64));
+    appendRecords(queue, 0, 200);
+    TEST_ASSERT_TRUE(queue.flush());
+    size_t before = segmentCount();
+    TEST_ASSERT_GREATER_THAN(4, before);
+
+    TEST_ASSERT_EQUAL(100, expectRecords(queue, 0, 100));
+    TEST_ASSERT_TRUE(queue.commit());
+    size_t middle = segmentCount();
+    TEST_ASSERT_LESS_THAN(before, middle);
+
+    TEST_ASSERT_EQUAL(100, expectRecords(queue, 100, 200));
+    TEST_ASSERT_TRUE(queue.commit());
+    TEST_ASSERT_LESS_OR_EQUAL(1, segmentCount());
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_capacity_drops_oldest_segments()
+{
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin(1024, 4));
+    appendRecords(queue, 0, 400);
+    TEST_ASSERT_TRUE(queue.flush());
+    TEST_ASSERT_GREATER_THAN(0, queue.droppedSegments());
+    TEST_ASSERT_LESS_OR_EQUAL(4, segmentCount());
+
+    // 剩下的是最新的记录, 最后一条仍然完整
+    uint8_t out[StoreQueue::MAX_RECORD], expected[64];
+    size_t len, last = 0;
+    uint32_t n = 0;
+    while ((len = queue.read(out, sizeof(out))) > 0)
+    {
+        last = len;
+        n++;
+    }
+    TEST_ASSERT_LESS_THAN(400, n);
+    TEST_ASSERT_EQUAL(makeRecord(399, expected), last);
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, last);
+}
+
+void test_upload_cycles_keep_segment_open()
+{
+    // 每采样一次就尝试上传一次但一直失败: 读取追上写入时不换段, 段数不会因上传次数达到上限
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin(1024, 4));
+    for (uint32_t i = 0; i < 60; i++)
+    {
+        appendRecords(queue, i, i + 1);
+        TEST_ASSERT_EQUAL(i + 1, expectRecords(queue, 0, i + 1));
+        queue.rewind();
+    }
+    TEST_ASSERT_EQUAL(0, queue.droppedSegments());
+    TEST_ASSERT_LESS_OR_EQUAL(3, segmentCount());
+    TEST_ASSERT_EQUAL(60, expectRecords(queue, 0, 60));
+    TEST_ASSERT_TRUE(queue.commit());
+    TEST_ASSERT_TRUE(queue.empty());
+
+    // 上传中断时按字节数积累, 接近 段大小 * 段数 才开始丢弃
+    uint32_t n = 0;
+    size_t bytes = 0;
+    uint8_t data[64];
+    while (queue.droppedSegments() == 0)
+    {
+        size_t len = makeRecord(n, data);
+        TEST_ASSERT_TRUE(queue.append(data, len));
+        bytes += 7 + len;
+        n++;
+    }
+    TEST_ASSERT_GREATER_THAN(3 * 1024, bytes);
+
+    // 读取追上写入后继续追加, 新记录仍能读出
+    StoreQueue fresh(hostFs, "/fresh");
+    TEST_ASSERT_TRUE(fresh.begin());
+    appendRecords(fresh, 0, 3);
+    TEST_ASSERT_EQUAL(3, expectRecords(fresh, 0, 3));
+    appendRecords(fresh, 3, 5);
+    TEST_ASSERT_EQUAL(2, expectRecords(fresh, 3, 10));
+    TEST_ASSERT_TRUE(fresh.commit());
+    TEST_ASSERT_TRUE(fresh.empty());
+}
+
+void test_read_batch()
+{
+    StoreQueue queue(hostFs);
+    TEST_ASSERT_TRUE(queue.begin());
+    appendRecords(queue, 0, 20);
+
+    // 每条记录前有2字节长度, 放不下的记录留到下一批
+    uint8_t batch[128], expected[64];
+    uint32_t count;
+    size_t len = queue.readBatch(batch, sizeof(batch), count);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(batch), len);
+    size_t pos = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        size_t recordLen = (batch[pos] << 8) | batch[pos + 1];
+        TEST_ASSERT_EQUAL(makeRecord(i, expected), recordLen);
+        TEST_ASSERT_EQUAL_MEMORY(expected, batch + pos + 2, recordLen);
+        pos += 2 + recordLen;
+    }
+    TEST_ASSERT_EQUAL(len, pos);
+    TEST_ASSERT_TRUE(queue.commit());
+    uint32_t first = count;
+
+    // 缓冲区放不下下一条记录时不读出, 读取位置不变
+    TEST_ASSERT_EQUAL(0, queue.readBatch(batch, 4, count));
+    TEST_ASSERT_EQUAL(0, count);
+
+    // 剩余记录在一批中读出
+    static uint8_t big[4096];
+    len = queue.readBatch(big, sizeof(big), count);
+    TEST_ASSERT_EQUAL(20 - first, count);
+    pos = 0;
+    for (uint32_t i = first; i < 20; i++)
+    {
+        size_t recordLen = (big[pos] << 8) | big[pos + 1];
+        TEST_ASSERT_EQUAL(makeRecord(i, expected), recordLen);
+        TEST_ASSERT_EQUAL_MEMORY(expected, big + pos + 2, recordLen);
+        pos += 2 + recordLen;
+    }
+    TEST_ASSERT_EQUAL(len, pos);
+    TEST_ASSERT_TRUE(queue.commit());
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_append_and_read);
+    RUN_TEST(test_rewind_and_commit);
+    RUN_TEST(test_unflushed_page_lost_on_power_cut);
+    RUN_TEST(test_corrupt_tail_skipped);
+    RUN_TEST(test_compaction_removes_consumed_segments);
+    RUN_TEST(test_capacity_drops_oldest_segments);
+    RUN_TEST(test_upload_cycles_keep_segment_open);
+    RUN_TEST(test_read_batch);
+    return UNITY_END();
+}
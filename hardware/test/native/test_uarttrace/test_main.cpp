@@ -0,0 +1,136 @@
+/*
+ * 串口记录与回放测试
+ * 通过 UartTrace 记录与模拟模块的一次交互, 再用 UartReplay 回放并检查时序和发送内容的对比
+ */
+#include <Arduino.h>
+#include <unity.h>
+#include "uarttrace.h"
+
+// 模拟模块: 收到以\r结尾的指令后回复 OK
+class FakeModem : public Stream
+{
+public:
+    int available() override { return (int)(_rx.size() - _pos); }
+    int read() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos++] : -1; }
+    int peek() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos] : -1; }
+    size_t write(uint8_t c) override
+    {
+        if (c == '\r')
+        {
+            _rx += "\r\nOK\r\n";
+        }
+        return 1;
+    }
+    using Print::write;
+
+private:
+    std::string _rx;
+    size_t _pos = 0;
+};
+
+static uint8_t traceBuffer[256];
+
+static String readAll(Stream &s)
+{
+    String out;
+    int c;
+    while ((c = s.read()) >= 0)
+    {
+        out += (char)c;
+    }
+    return out;
+}
+
+// 记录一次 AT 指令交互, 回复比指令晚 gapMs 毫秒读取
+static size_t recordSession(uint32_t gapMs)
+{
+    FakeModem modem;
+    UartTrace trace;
+    trace.begin(modem, traceBuffer, sizeof(traceBuffer));
+    trace.start();
+    trace.print("AT\r");
+    delay(gapMs);
+    TEST_ASSERT_EQUAL_STRING("\r\nOK\r\n", readAll(trace).c_str());
+    trace.stop();
+    TEST_ASSERT_FALSE(trace.overflowed());
+    return trace.length();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_replay_matches_recording()
+{
+    size_t len = recordSession(0);
+    // 两条记录: 时间增量 + 头 + 数据
+    TEST_ASSERT_GREATER_OR_EQUAL(2 + 3 + 2 + 6, len);
+
+    UartReplay replay;
+    replay.begin(traceBuffer, len, false);
+    TEST_ASSERT_EQUAL(0, replay.available());   // 发送记录之前没有接收数据
+    replay.print("AT\r");
+    TEST_ASSERT_EQUAL_STRING("\r\nOK\r\n", readAll(replay).c_str());
+    TEST_ASSERT_TRUE(replay.finished());
+    TEST_ASSERT_EQUAL_UINT32(0, replay.mismatches());
+    TEST_ASSERT_EQUAL_UINT32(0, replay.unexpected());
+    TEST_ASSERT_EQUAL_UINT32(6, replay.rxBytes());
+}
+
+void test_replay_counts_divergence()
+{
+    size_t len = recordSession(0);
+
+    UartReplay replay;
+    replay.begin(traceBuffer, len, false);
+    replay.print("AX\r");
+    readAll(replay);
+    replay.print("AT\r");
+    TEST_ASSERT_TRUE(replay.finished());
+    TEST_ASSERT_EQUAL_UINT32(1, replay.mismatches());
+    TEST_ASSERT_EQUAL_UINT32(3, replay.unexpected());
+}
+
+void test_replay_keeps_original_timing()
+{
+    size_t len = recordSession(30);
+
+    UartReplay replay;
+    replay.begin(traceBuffer, len, true);
+    replay.print("AT\r");
+    TEST_ASSERT_EQUAL(0, replay.available());
+    delay(40);
+    TEST_ASSERT_EQUAL(6, replay.available());
+
+    // 尽快回放时忽略时间间隔
+    replay.begin(traceBuffer, len, false);
+    replay.print("AT\r");
+    TEST_ASSERT_EQUAL(6, replay.available());
+}
+
+void test_overflow_keeps_complete_records()
+{
+    FakeModem modem;
+    UartTrace trace;
+    trace.begin(modem, traceBuffer, 8);
+    trace.start();
+    trace.print("AT\r");
+    readAll(trace);
+    TEST_ASSERT_TRUE(trace.overflowed());
+    TEST_ASSERT_EQUAL(5, trace.length());   // 只保留完整的发送记录
+
+    UartReplay replay;
+    replay.begin(traceBuffer, trace.length(), false);
+    replay.print("AT\r");
+    TEST_ASSERT_TRUE(replay.finished());
+    TEST_ASSERT_EQUAL_UINT32(0, replay.mismatches());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_matches_recording);
+    RUN_TEST(test_replay_counts_divergence);
+    RUN_TEST(test_replay_keeps_original_timing);
+    RUN_TEST(test_overflow_keeps_complete_records);
+    return UNITY_END();
+}